@@ -0,0 +1,436 @@
+// Benchmark.cpp : Times every engine on a range of boards and prints the results as JSON.
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <functional>
+#include <cstdio>
+#include <tbb/global_control.h>
+#include <tbb/info.h>
+
+#include "Board.h"
+#include "PackedBoard.h"
+#include "GenerationsBoard.h"
+#include "InfiniteBoard.h"
+#include "HashLife.h"
+#include "MappedBoard.h"
+#include "Ensemble.h"
+
+// Game of Life CPP, benchmark
+//
+// Every engine runs from the same starting board for each size, density and thread count.
+// A run steps until it has taken at least --min-time seconds. Boards have dead edges because
+// every engine supports them. Scaling efficiency is the speedup over one thread divided by the thread count.
+
+// Steps an engine Engine::generationsPerStep generations
+typedef std::function<void()> Stepper;
+
+struct Engine
+{
+    std::string name;
+    int maxSize; // bigger boards are skipped, 0 for no limit
+    uint64_t lanes; // boards stepped at once, cells per generation are lanes * size * size
+    uint64_t generationsPerStep;
+    std::function<Stepper(Board& start)> make; // loads the starting board, returns nothing if the engine can't run here
+};
+
+struct Result
+{
+    std::string engine;
+    int size;
+    std::string density;
+    int threads;
+    uint64_t generations;
+    double seconds;
+    double cellsPerSecond;
+};
+
+static void printUsage() {
+    std::cout <<
+        "Usage: Benchmark [options]\n"
+        "  --sizes LIST         board sides (64,256,1024,4096,16384)\n"
+        "  --densities LIST     empty, 10, 50 and soup (all of them), soup is 50% settled for 128 generations\n"
+        "  --threads LIST       thread counts (1, 2, 4 ... up to all cores)\n"
+        "  --engines LIST       engines to run (all of them)\n"
+        "  --min-time SECONDS   time per run (0.5)\n"
+        "  --output FILE        writes the JSON here instead of to the console\n"
+        "  --help               shows this\n";
+}
+
+static std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// Copies a board cell by cell through setRow, Board can't be copied
+static std::unique_ptr<Board> copyBoard(Board& source) {
+    std::unique_ptr<Board> copy(new Board(source.getBoardSizeX(), source.getBoardSizeY()));
+    for (int row = 0; row < source.getBoardSizeY(); row++)
+    {
+        copy->setRow(row, source.getRow(row));
+    }
+    return copy;
+}
+
+// Random cells, the same ones every time for a size and density
+static void fillRandom(Board& board, int percent) {
+    std::mt19937 random(board.getBoardSizeX() * 7919 + percent);
+    std::vector<char> row(board.getBoardSizeX());
+    for (int r = 0; r < board.getBoardSizeY(); r++)
+    {
+        for (char& cell : row)
+        {
+            cell = (int)(random() % 100) < percent ? '#' : '.';
+        }
+        board.setRow(r, row.data());
+    }
+}
+
+static std::unique_ptr<Board> makeStart(int size, const std::string& density) {
+    std::unique_ptr<Board> start(new Board(size, size));
+    if (density == "10") {
+        fillRandom(*start, 10);
+    }
+    else if (density == "50" || density == "soup") {
+        fillRandom(*start, 50);
+    }
+
+    // A settled soup has mostly still lifes and oscillators left, the bit packed engine gets it there fastest
+    if (density == "soup") {
+        PackedBoard packed(size, size);
+        packed.loadFromBoard(*start);
+        for (int i = 0; i < 128; i++)
+        {
+            packed.nextGeneration();
+        }
+        packed.storeToBoard(*start);
+        start->generation = 0;
+    }
+    return start;
+}
+
+static std::vector<Engine> makeEngines() {
+    std::vector<Engine> engines;
+
+    // The char board once per kernel, kernels the CPU doesn't have are skipped
+    const std::pair<const char*, Board::Kernel> kernels[] = {
+        { "board-scalar", Board::Kernel::Scalar },
+        { "board-sse41", Board::Kernel::SSE41 },
+        { "board-avx2", Board::Kernel::AVX2 },
+        { "board-table", Board::Kernel::Table },
+    };
+    for (auto& kernel : kernels)
+    {
+        Board::Kernel k = kernel.second;
+        engines.push_back({ kernel.first, 0, 1, 1, [k](Board& start) -> Stepper
+        {
+            std::shared_ptr<Board> board(copyBoard(start).release());
+            if (!board->setKernel(k)) {
+                return Stepper();
+            }
+            return [board]() { board->nextGeneration(); };
+        } });
+    }
+
+    // nextGenerations runs 8 generations per pass over the board
+    engines.push_back({ "board-temporal", 0, 1, 8, [](Board& start) -> Stepper
+    {
+        std::shared_ptr<Board> board(copyBoard(start).release());
+        return [board]() { board->nextGenerations(8); };
+    } });
+
+    engines.push_back({ "packed", 0, 1, 1, [](Board& start) -> Stepper
+    {
+        std::shared_ptr<PackedBoard> board(new PackedBoard(start.getBoardSizeX(), start.getBoardSizeY()));
+        board->loadFromBoard(start);
+        return [board]() { board->nextGeneration(); };
+    } });
+
+    engines.push_back({ "generations", 0, 1, 1, [](Board& start) -> Stepper
+    {
+        std::shared_ptr<GenerationsBoard> board(new GenerationsBoard(start.getBoardSizeX(), start.getBoardSizeY()));
+        board->setRule("B3/S23/2");
+        board->loadFromBoard(start);
+        return [board]() { board->nextGeneration(); };
+    } });
+
+    engines.push_back({ "infinite", 0, 1, 1, [](Board& start) -> Stepper
+    {
+        // The plane has no edges, the cells that leave the board keep being stepped
+        std::shared_ptr<InfiniteBoard> board(new InfiniteBoard());
+        board->loadFromBoard(start);
+        return [board]() { board->nextGeneration(); };
+    } });
+
+    engines.push_back({ "hashlife", 0, 1, 1, [](Board& start) -> Stepper
+    {
+        std::shared_ptr<HashLife> board(new HashLife());
+        board->loadFromBoard(start);
+        return [board]() { board->advance(1); };
+    } });
+
+    engines.push_back({ "mapped", 0, 1, 1, [](Board& start) -> Stepper
+    {
+        std::string path = "benchmark.map";
+        std::remove(path.c_str());
+        std::shared_ptr<MappedBoard> board(new MappedBoard(), [path](MappedBoard* mapped)
+        {
+            delete mapped;
+            std::remove(path.c_str());
+        });
+        if (!board->open(path, start.getBoardSizeX(), start.getBoardSizeY())) {
+            return Stepper();
+        }
+        board->loadFromBoard(start);
+        return [board]() { board->nextGeneration(); };
+    } });
+
+    // Every lane gets the same board, which is as fast as different ones
+    engines.push_back({ "ensemble64", 1024, 64, 1, [](Board& start) -> Stepper
+    {
+        std::shared_ptr<EnsembleBoard<uint64_t>> board(new EnsembleBoard<uint64_t>(start.getBoardSizeX(), start.getBoardSizeY()));
+        for (int lane = 0; lane < EnsembleBoard<uint64_t>::LANES; lane++)
+        {
+            board->loadFromBoard(lane, start);
+        }
+        return [board]() { board->nextGeneration(); };
+    } });
+
+    engines.push_back({ "ensemble256", 1024, 256, 1, [](Board& start) -> Stepper
+    {
+        if (!cpuHasAvx2()) {
+            return Stepper();
+        }
+        std::shared_ptr<EnsembleBoard<Lanes256>> board(new EnsembleBoard<Lanes256>(start.getBoardSizeX(), start.getBoardSizeY()));
+        for (int lane = 0; lane < EnsembleBoard<Lanes256>::LANES; lane++)
+        {
+            board->loadFromBoard(lane, start);
+        }
+        return [board]() { board->nextGeneration(); };
+    } });
+
+    return engines;
+}
+
+// Steps until minTime has passed, at least 2 steps so a slow first step doesn't decide it
+static Result timeRun(const Stepper& step, uint64_t generationsPerStep, double minTime) {
+    Result result = {};
+    step(); // warm up, first touches of new memory aren't part of stepping
+
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    uint64_t batch = 1;
+    while (seconds < minTime || result.generations < 2 * generationsPerStep) {
+        for (uint64_t i = 0; i < batch; i++)
+        {
+            step();
+        }
+        result.generations += batch * generationsPerStep;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        batch *= 2;
+    }
+    result.seconds = seconds;
+    return result;
+}
+
+static std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static void writeJson(std::ostream& out, const std::vector<Result>& results, double minTime) {
+    out << "{\n";
+    out << "  \"machine\": { \"cores\": " << tbb::info::default_concurrency() << ", \"sse41\": " << (cpuHasSse41() ? "true" : "false")
+        << ", \"avx2\": " << (cpuHasAvx2() ? "true" : "false") << " },\n";
+    out << "  \"min_time\": " << minTime << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+
+        // Efficiency against the same run on one thread, if there was one
+        double efficiency = -1;
+        for (const Result& single : results)
+        {
+            if (single.threads == 1 && single.engine == r.engine && single.size == r.size && single.density == r.density) {
+                efficiency = r.cellsPerSecond / single.cellsPerSecond / r.threads;
+            }
+        }
+
+        out << (i ? ",\n" : "\n") << "    { \"engine\": " << jsonString(r.engine) << ", \"size\": " << r.size
+            << ", \"density\": " << jsonString(r.density) << ", \"threads\": " << r.threads
+            << ", \"generations\": " << r.generations << ", \"seconds\": " << r.seconds
+            << ", \"cells_per_second\": " << r.cellsPerSecond << ", \"ns_per_cell\": " << 1e9 / r.cellsPerSecond
+            << ", \"scaling_efficiency\": ";
+        if (efficiency < 0) {
+            out << "null }";
+        }
+        else {
+            out << efficiency << " }";
+        }
+    }
+    out << "\n  ]\n}\n";
+}
+
+/* MAIN */
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> sizes = { "64", "256", "1024", "4096", "16384" };
+    std::vector<std::string> densities = { "empty", "10", "50", "soup" };
+    std::vector<std::string> threadCounts;
+    std::vector<std::string> engineNames;
+    double minTime = 0.5;
+    std::string outputFile;
+
+    for (int cores = 1; cores < tbb::info::default_concurrency(); cores *= 2)
+    {
+        threadCounts.push_back(std::to_string(cores));
+    }
+    threadCounts.push_back(std::to_string(tbb::info::default_concurrency()));
+
+    // Read the command line, every option but --help takes a value
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--help") {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing a value after " << option << ".\n";
+            printUsage();
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        if (option == "--sizes") {
+            sizes = splitList(value);
+        }
+        else if (option == "--densities") {
+            densities = splitList(value);
+        }
+        else if (option == "--threads") {
+            threadCounts = splitList(value);
+        }
+        else if (option == "--engines") {
+            engineNames = splitList(value);
+        }
+        else if (option == "--min-time") {
+            minTime = std::atof(value.c_str());
+        }
+        else if (option == "--output") {
+            outputFile = value;
+        }
+        else {
+            std::cerr << "Unknown option " << option << ".\n";
+            printUsage();
+            return 1;
+        }
+    }
+
+    // Everything on the command line is checked before anything runs
+    std::vector<Engine> engines;
+    for (Engine& engine : makeEngines())
+    {
+        if (engineNames.empty() || std::find(engineNames.begin(), engineNames.end(), engine.name) != engineNames.end()) {
+            engines.push_back(engine);
+        }
+    }
+    if (engines.size() < std::max<size_t>(1, engineNames.size())) {
+        std::cerr << "Unknown engine in \"--engines\", the engines are board-scalar, board-sse41, board-avx2, board-table,"
+            " board-temporal, packed, generations, infinite, hashlife, mapped, ensemble64 and ensemble256.\n";
+        return 1;
+    }
+    for (const std::string& size : sizes)
+    {
+        if (std::atoi(size.c_str()) < 1 || std::atoi(size.c_str()) > 65535) {
+            std::cerr << "Bad size \"" << size << "\", sizes are 1 to 65535.\n";
+            return 1;
+        }
+    }
+    for (const std::string& density : densities)
+    {
+        if (density != "empty" && density != "10" && density != "50" && density != "soup") {
+            std::cerr << "Bad density \"" << density << "\", the densities are empty, 10, 50 and soup.\n";
+            return 1;
+        }
+    }
+    for (const std::string& threads : threadCounts)
+    {
+        if (std::atoi(threads.c_str()) < 1) {
+            std::cerr << "Bad thread count \"" << threads << "\".\n";
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    for (const std::string& sizeText : sizes)
+    {
+        int size = std::atoi(sizeText.c_str());
+        for (const std::string& density : densities)
+        {
+            std::unique_ptr<Board> start = makeStart(size, density);
+            for (const std::string& threadText : threadCounts)
+            {
+                int threads = std::atoi(threadText.c_str());
+                tbb::global_control threadLimit(tbb::global_control::max_allowed_parallelism, threads);
+
+                for (const Engine& engine : engines)
+                {
+                    if (engine.maxSize && size > engine.maxSize) {
+                        continue;
+                    }
+                    Stepper step = engine.make(*start);
+                    if (!step) {
+                        continue; // this CPU doesn't have the kernel
+                    }
+
+                    Result result = timeRun(step, engine.generationsPerStep, minTime);
+                    result.engine = engine.name;
+                    result.size = size;
+                    result.density = density;
+                    result.threads = threads;
+                    result.cellsPerSecond = (double)engine.lanes * size * size * result.generations / result.seconds;
+                    results.push_back(result);
+
+                    // Progress goes to the console even when the JSON goes to a file
+                    std::cerr << engine.name << " " << size << "x" << size << " " << density << " " << threads << " threads: "
+                        << result.cellsPerSecond / 1e9 << " Gcells/s\n";
+                }
+            }
+        }
+    }
+
+    if (outputFile.empty()) {
+        writeJson(std::cout, results, minTime);
+    }
+    else {
+        std::ofstream outfile(outputFile);
+        writeJson(outfile, results, minTime);
+        if (!outfile) {
+            std::cerr << "Couldn't write \"" << outputFile << "\".\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+
+#include "Rule.h"
+
+// Lookup table for 2x2 blocks of cells
+//
+// A 4x4 neighborhood has 16 cells, so it fits in a 16 bit index, bit 4 * r + c is the cell
+// in row r and column c. The middle 2x2 cells only have neighbors inside the 4x4 area,
+// so the table can hold their next generation for every possible neighborhood.
+// The table for B3/S23 is built the first time it's used, tables for other rules are built
+// when the rule is picked.
+
+struct BlockTable
+{
+    // Low 4 bits are the next states of the 2x2 block, bit 2 * r + c is row r and column c
+    // High 4 bits are set for cells that survive, their age goes up instead of resetting
+    uint8_t entries[1 << 16] = {};
+
+    /**
+    * Next state of one cell
+    * @param birth and survive are the rule's masks, bit n is set for n neighbors
+    * @return bit 0 is the new state, bit 1 is set if the age goes up instead of resetting
+    */
+    static int stepCell(bool alive, int numNeighbors, uint16_t birth, uint16_t survive) {
+
+        /*  GOL RULES BELOW  */
+
+        if (alive && ((survive >> numNeighbors) & 1)) {
+            return 1 | 2;
+        }
+        else if (!alive && ((birth >> numNeighbors) & 1)) {
+            return 1;
+        }
+        return 0;
+    }
+
+    // Number of set bits in a 16 bit value
+    static int countBits(int v) {
+        v = v - ((v >> 1) & 0x5555);
+        v = (v & 0x3333) + ((v >> 2) & 0x3333);
+        v = (v + (v >> 4)) & 0x0F0F;
+        return (v + (v >> 8)) & 0x1F;
+    }
+
+    BlockTable(uint16_t birth, uint16_t survive) {
+        for (int neighborhood = 0; neighborhood < (1 << 16); neighborhood++)
+        {
+            int entry = 0;
+            for (int r = 0; r < 2; r++)
+            {
+                for (int c = 0; c < 2; c++)
+                {
+                    // 0x757 is a 3x3 square without its middle, shifted onto the cell's neighbors
+                    int shift = 4 * r + c;
+                    int numNeighbors = countBits(neighborhood & (0x757 << shift));
+                    int cell = stepCell(((neighborhood >> (shift + 5)) & 1) != 0, numNeighbors, birth, survive);
+                    entry |= (cell & 1) << (2 * r + c);
+                    entry |= (cell >> 1) << (4 + 2 * r + c);
+                }
+            }
+            entries[neighborhood] = (uint8_t)entry;
+        }
+    }
+};
+
+// The B3/S23 table, shared by every board and built once for the whole program
+inline const BlockTable& blockTable() {
+    static const BlockTable table(LifeRule::BIRTH_MASK, LifeRule::SURVIVE_MASK);
+    return table;
+}
@@ -4,127 +4,1296 @@
 #include <fstream>
 #include <algorithm>    // std::for_each
 #include <string>
+#include <cstring>
+#include <memory>
+#include <atomic>
+#include <deque>
+#include <unordered_map>
+#include <tbb/blocked_range.h>
+#include <tbb/blocked_range2d.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/partitioner.h>
+#include <tbb/cache_aligned_allocator.h>
+#include <tbb/enumerable_thread_specific.h>
+
+#include "CpuFeatures.h"
+#include "BlockTable.h"
+#include "Rule.h"
+#include "Codec.h"
+#include "Pattern.h"
+#include "MappedFile.h"
 
 class Board
 {
     private:
 
+        typedef std::vector<char, tbb::cache_aligned_allocator<char>> Cells;
+        typedef std::vector<uint8_t, tbb::cache_aligned_allocator<uint8_t>> Ages;
+
+        enum { MAX_AGE = 255 }; // ages stop counting here
+
+        // The board is split into tiles, only tiles near a change get recomputed
+        enum { TILE_WIDTH = 128, TILE_HEIGHT = 64 };
+
         uint16_t BOARDSIZE_Y = 20;
         uint16_t BOARDSIZE_X = 20;
-        std::vector<std::vector<char>> board; // vector that stores the board
-        std::vector<std::vector<int>> boardAge; // vector that stores the age of each cell
+        size_t STRIDE = 22; // length of a stored row, the board plus a ghost cell on each side
+        Cells board; // stores the board row by row surrounded by a one cell ghost border
+        Cells boardNext; // the next generation is written here and then swapped with board
+        Ages boardAge; // stores the age of each cell, laid out like board, ages saturate at MAX_AGE
+
+        int TILES_X = 1;
+        int TILES_Y = 1;
+        std::vector<char> tileChanged; // 1 if a cell in the tile changed last generation (or was edited)
+        std::vector<char> tileChangedNext;
+
+        // Tasks cover blocks of GRAIN_Y x GRAIN_X tiles, the partitioners remember which thread ran
+        // each block so the same core keeps working on the same memory every generation
+        int GRAIN_Y = 2;
+        int GRAIN_X = 1;
+        tbb::affinity_partitioner tilePartitioner;
+        tbb::affinity_partitioner temporalPartitioner;
+
+        // A tile plus its halo, copied out of the board so several generations can run in cache
+        struct TileScratch
+        {
+            Cells cells;
+            Cells cellsNext;
+            Ages ages;
+        };
+
+        int temporalDepth = 8; // generations per pass in nextGenerations
+        tbb::enumerable_thread_specific<TileScratch> tileScratch;
+
+        // Zobrist hash of the board, the XOR of cellKey over every live cell
+        // Steps only XOR in the keys of cells that flipped, each tile adds up its own
+        uint64_t hash = 0;
+        std::vector<uint64_t> tileHashChange;
+
+        // Hashes of recent generations, a hash that comes back means the board is periodic
+        size_t historyLength = 1024;
+        std::unordered_map<uint64_t, uint64_t> history; // hash to the generation it was seen in
+        std::deque<uint64_t> historyOrder; // oldest first, so the oldest can be dropped
+        bool historyStale = true; // the board was edited, the history starts over on the next step
+        uint64_t cycleStart = 0;
+        uint64_t cyclePeriod = 0; // 0 until a repeat is found
+
+        // Start of a snapshot file, followed by the compressed size of every chunk and then the chunks
+        // Each chunk is SNAPSHOT_ROWS rows packed by packCells, every row starting on a new byte,
+        // and coded by compressRuns. Numbers are little endian.
+        struct SnapshotHeader
+        {
+            char magic[8];
+            uint32_t sizeX;
+            uint32_t sizeY;
+            uint64_t generation;
+            uint16_t birth;
+            uint16_t survive;
+            uint8_t kernel;
+            uint8_t edgeMode;
+            uint8_t engine; // 0 for Board, other engines can write their own body
+            uint8_t reserved;
+            uint32_t rowsPerChunk;
+            uint32_t chunkCount;
+        };
+        static_assert(sizeof(SnapshotHeader) == 40, "the snapshot header is written as it is in memory");
+
+        enum { SNAPSHOT_ROWS = 64 }; // rows per chunk, chunks are packed and unpacked in parallel
+
+        // Index of a cell in the flat buffers, rows and columns -1 and BOARDSIZE are the ghost border
+        size_t index(int row, int col) {
+            return (size_t)(row + 1) * STRIDE + (col + 1);
+        }
+
+        static int wrap(int value, int size) {
+            value %= size;
+            return value < 0 ? value + size : value;
+        }
+
+        /**
+        * Fills the ghost border around board, this runs once per generation
+        * Dead edges get dead ghost cells, wrapping edges get copies of the opposite side
+        * so the kernels never have to check bounds
+        */
+        void refreshGhostCells() {
+            if (edgeMode == EdgeMode::Wrap) {
+                for (int row = 0; row < BOARDSIZE_Y; row++)
+                {
+                    board[index(row, -1)] = board[index(row, BOARDSIZE_X - 1)];
+                    board[index(row, BOARDSIZE_X)] = board[index(row, 0)];
+                }
+                // Whole rows including their ghost columns, that takes care of the corners
+                std::memcpy(&board[index(-1, -1)], &board[index(BOARDSIZE_Y - 1, -1)], STRIDE);
+                std::memcpy(&board[index(BOARDSIZE_Y, -1)], &board[index(0, -1)], STRIDE);
+            }
+            else {
+                for (int row = 0; row < BOARDSIZE_Y; row++)
+                {
+                    board[index(row, -1)] = '.';
+                    board[index(row, BOARDSIZE_X)] = '.';
+                }
+                std::memset(&board[index(-1, -1)], '.', STRIDE);
+                std::memset(&board[index(BOARDSIZE_Y, -1)], '.', STRIDE);
+            }
+        }
+
+        // Flags every tile so the next generation recomputes the whole board
+        void markAllTilesChanged() {
+            std::fill(tileChanged.begin(), tileChanged.end(), 1);
+        }
+
+        // Random looking key for a cell, splitmix64 of its position
+        uint64_t cellKey(int row, int col) {
+            uint64_t z = (uint64_t)row * BOARDSIZE_X + col + 0x9E3779B97F4A7C15ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // XOR of the keys of cells in part of a row that are alive in only one of board and boardNext
+        uint64_t hashChanges(int row, int colBegin, int colEnd) {
+            const char* before = &board[index(row, 0)];
+            const char* after = &boardNext[index(row, 0)];
+            uint64_t change = 0;
+            for (int col = colBegin; col < colEnd; col++)
+            {
+                if ((before[col] == '#') != (after[col] == '#')) {
+                    change ^= cellKey(row, col);
+                }
+            }
+            return change;
+        }
+
+        // Hashes the whole board again, for edits that replace everything
+        void rehash() {
+            hash = tbb::parallel_reduce(tbb::blocked_range<int>(0, BOARDSIZE_Y), (uint64_t)0, [&](tbb::blocked_range<int> ib, uint64_t sum)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    const char* cell = &board[index(row, 0)];
+                    for (int col = 0; col < BOARDSIZE_X; col++)
+                    {
+                        if (cell[col] == '#') {
+                            sum ^= cellKey(row, col);
+                        }
+                    }
+                }
+                return sum;
+            },
+            [](uint64_t a, uint64_t b) { return a ^ b; });
+            historyStale = true;
+        }
+
+        // Adds the current generation to the history, the first hash that comes back gives the cycle
+        void recordHistory() {
+            auto found = history.find(hash);
+            if (found != history.end()) {
+                if (cyclePeriod == 0) {
+                    cycleStart = found->second;
+                    cyclePeriod = generation - found->second;
+                }
+                return;
+            }
+
+            history[hash] = generation;
+            historyOrder.push_back(hash);
+            if (historyOrder.size() > historyLength) {
+                history.erase(historyOrder.front());
+                historyOrder.pop_front();
+            }
+        }
+
+        // Starts the history over from the current generation if the board was edited
+        void startHistory() {
+            if (historyStale) {
+                history.clear();
+                historyOrder.clear();
+                cycleStart = 0;
+                cyclePeriod = 0;
+                historyStale = false;
+                recordHistory();
+            }
+        }
+
+        // Applies the changes the tiles found in the last step
+        void applyTileHashChanges() {
+            for (uint64_t change : tileHashChange)
+            {
+                hash ^= change;
+            }
+        }
+
+        /**
+        * Computes the next state and age of a single cell, its neighbors have to be in the buffers
+        * This is the reference implementation, every other kernel has to match it
+        * The kernels only touch the ages if AGES is true
+        */
+        template <bool AGES, class R>
+        static void stepInteriorCell(const R& rule, const char* above, const char* middle, const char* below, char* out, uint8_t* age, int col) {
+            int numNeighbors = (above[col - 1] == '#') + (above[col] == '#') + (above[col + 1] == '#')
+                + (middle[col - 1] == '#') + (middle[col + 1] == '#')
+                + (below[col - 1] == '#') + (below[col] == '#') + (below[col + 1] == '#');
+
+            /*  GOL RULES BELOW  */
+
+            bool alive = middle[col] == '#';
+            bool survives = alive && rule.survives(numNeighbors);
+            out[col] = survives || (!alive && rule.born(numNeighbors)) ? '#' : '.';
+            if (AGES) {
+                age[col] = survives ? age[col] + (age[col] != MAX_AGE) : 0;
+            }
+        }
+
+        /**
+        * Computes the cells [colBegin, colEnd) of a row, their neighbors have to be in the buffers
+        * On the board the ghost border provides them, temporal blocking runs this on its own tiles
+        */
+        template <bool AGES, class R>
+        void stepRow(const R& rule, const char* above, const char* middle, const char* below, char* out, uint8_t* age, int colBegin, int colEnd) {
+            int col = colBegin;
+
+#ifdef GOL_X86
+            // AVX2 leaves up to 31 cells, SSE4.1 takes the next 16 of those
+            if (kernel == Kernel::AVX2) {
+                col = stepAvx2<AGES>(rule, above, middle, below, out, age, col, colEnd);
+            }
+            if (kernel == Kernel::AVX2 || kernel == Kernel::SSE41) {
+                col = stepSse41<AGES>(rule, above, middle, below, out, age, col, colEnd);
+            }
+#endif
+
+            for (; col < colEnd; col++)
+            {
+                stepInteriorCell<AGES>(rule, above, middle, below, out, age, col);
+            }
+        }
+
+        // Bits of the four cells starting at p, bit j is p[j]
+        static int cellBits4(const char* p) {
+            return (p[0] == '#') | ((p[1] == '#') << 1) | ((p[2] == '#') << 2) | ((p[3] == '#') << 3);
+        }
+
+        /**
+        * Lookup table kernel, computes two rows at once in 2x2 blocks
+        * Each block's 4x4 neighborhood is packed into 16 bits and looked up in the rule's BlockTable
+        * The index slides two columns at a time so every cell is only read twice
+        */
+        template <bool AGES, class R>
+        static void stepRowPairTable(const R& rule, const BlockTable& table, const char* above, const char* top, const char* bottom, const char* below,
+                                     char* outTop, char* outBottom, uint8_t* ageTop, uint8_t* ageBottom, int colBegin, int colEnd) {
+            int col = colBegin;
+
+            if (col + 2 <= colEnd) {
+                // Columns col - 1 to col + 2 of each row, the 4 bits of row r start at bit 4 * r
+                int neighborhood = cellBits4(above + col - 1) | (cellBits4(top + col - 1) << 4)
+                    | (cellBits4(bottom + col - 1) << 8) | (cellBits4(below + col - 1) << 12);
+
+                for (;;)
+                {
+                    int entry = table.entries[neighborhood];
+                    outTop[col] = entry & 1 ? '#' : '.';
+                    outTop[col + 1] = entry & 2 ? '#' : '.';
+                    outBottom[col] = entry & 4 ? '#' : '.';
+                    outBottom[col + 1] = entry & 8 ? '#' : '.';
+                    if (AGES) {
+                        ageTop[col] = entry & 16 ? ageTop[col] + (ageTop[col] != MAX_AGE) : 0;
+                        ageTop[col + 1] = entry & 32 ? ageTop[col + 1] + (ageTop[col + 1] != MAX_AGE) : 0;
+                        ageBottom[col] = entry & 64 ? ageBottom[col] + (ageBottom[col] != MAX_AGE) : 0;
+                        ageBottom[col + 1] = entry & 128 ? ageBottom[col + 1] + (ageBottom[col + 1] != MAX_AGE) : 0;
+                    }
+
+                    col += 2;
+                    if (col + 2 > colEnd) {
+                        break;
+                    }
+
+                    // Drop the two left columns and bring in the two new right ones
+                    int right = (above[col + 1] == '#') | ((above[col + 2] == '#') << 1)
+                        | ((top[col + 1] == '#') << 4) | ((top[col + 2] == '#') << 5)
+                        | ((bottom[col + 1] == '#') << 8) | ((bottom[col + 2] == '#') << 9)
+                        | ((below[col + 1] == '#') << 12) | ((below[col + 2] == '#') << 13);
+                    neighborhood = ((neighborhood >> 2) & 0x3333) | (right << 2);
+                }
+            }
+
+            // An odd column is left over, its right neighbor might be past the ghost border
+            if (col < colEnd) {
+                stepInteriorCell<AGES>(rule, above, top, bottom, outTop, ageTop, col);
+                stepInteriorCell<AGES>(rule, top, bottom, below, outBottom, ageBottom, col);
+            }
+        }
+
+        /**
+        * Computes the cells [colBegin, colEnd) of the rows [rowBegin, rowEnd) of a buffer
+        * Row r of the buffer starts at cells + r * stride, its neighbors have to be in the buffer
+        */
+        template <bool AGES, class R>
+        void stepRows(const R& rule, const char* cells, char* out, uint8_t* age, size_t stride, int rowBegin, int rowEnd, int colBegin, int colEnd) {
+            int row = rowBegin;
+            if (kernel == Kernel::Table) {
+                for (; row + 2 <= rowEnd; row += 2)
+                {
+                    const char* top = cells + row * stride;
+                    stepRowPairTable<AGES>(rule, *table, top - stride, top, top + stride, top + 2 * stride,
+                                     out + row * stride, out + (row + 1) * stride, age + row * stride, age + (row + 1) * stride, colBegin, colEnd);
+                }
+            }
+
+            for (; row < rowEnd; row++)
+            {
+                const char* middle = cells + row * stride;
+                stepRow<AGES>(rule, middle - stride, middle, middle + stride, out + row * stride, age + row * stride, colBegin, colEnd);
+            }
+        }
+
+#ifdef GOL_X86
+        /**
+        * Marks the bytes of count that make a cell be born or survive under a fixed rule
+        * The masks are constants so only the compares the rule needs are left
+        */
+        template <uint16_t BIRTH, uint16_t SURVIVE>
+        GOL_TARGET_AVX2 static void matchAvx2(const FixedRule<BIRTH, SURVIVE>&, __m256i count, __m256i& born, __m256i& survives) {
+            born = _mm256_setzero_si256();
+            survives = _mm256_setzero_si256();
+            for (int n = 0; n <= 8; n++)
+            {
+                if ((BIRTH >> n) & 1) {
+                    born = _mm256_or_si256(born, _mm256_cmpeq_epi8(count, _mm256_set1_epi8((char)n)));
+                }
+                if ((SURVIVE >> n) & 1) {
+                    survives = _mm256_or_si256(survives, _mm256_cmpeq_epi8(count, _mm256_set1_epi8((char)n)));
+                }
+            }
+        }
+
+        // Any other rule looks the counts up in its tables with a byte shuffle
+        GOL_TARGET_AVX2 static void matchAvx2(const Rule& rule, __m256i count, __m256i& born, __m256i& survives) {
+            born = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)rule.birthTable)), count);
+            survives = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)rule.surviveTable)), count);
+        }
+
+        template <uint16_t BIRTH, uint16_t SURVIVE>
+        GOL_TARGET_SSE41 static void matchSse41(const FixedRule<BIRTH, SURVIVE>&, __m128i count, __m128i& born, __m128i& survives) {
+            born = _mm_setzero_si128();
+            survives = _mm_setzero_si128();
+            for (int n = 0; n <= 8; n++)
+            {
+                if ((BIRTH >> n) & 1) {
+                    born = _mm_or_si128(born, _mm_cmpeq_epi8(count, _mm_set1_epi8((char)n)));
+                }
+                if ((SURVIVE >> n) & 1) {
+                    survives = _mm_or_si128(survives, _mm_cmpeq_epi8(count, _mm_set1_epi8((char)n)));
+                }
+            }
+        }
+
+        GOL_TARGET_SSE41 static void matchSse41(const Rule& rule, __m128i count, __m128i& born, __m128i& survives) {
+            born = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)rule.birthTable), count);
+            survives = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)rule.surviveTable), count);
+        }
+
+        /**
+        * AVX2 kernel, computes 32 cells per iteration
+        * Live neighbors compare equal to -1 so subtracting the compare masks counts them
+        * @return the first column that was not computed
+        */
+        template <bool AGES, class R>
+        GOL_TARGET_AVX2 static int stepAvx2(const R& rule, const char* above, const char* middle, const char* below, char* out, uint8_t* age, int col, int colEnd) {
+            const R localRule = rule; // a local copy can't alias the output so its tables stay in registers
+            const __m256i alive = _mm256_set1_epi8('#');
+            const __m256i dead = _mm256_set1_epi8('.');
+            const __m256i one = _mm256_set1_epi8(1);
+
+            for (; col + 32 <= colEnd; col += 32)
+            {
+                __m256i count = _mm256_setzero_si256();
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(above + col - 1)), alive));
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(above + col)), alive));
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(above + col + 1)), alive));
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(middle + col - 1)), alive));
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(middle + col + 1)), alive));
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(below + col - 1)), alive));
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(below + col)), alive));
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(below + col + 1)), alive));
+
+                /*  GOL RULES BELOW  */
+
+                __m256i self = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(middle + col)), alive);
+                __m256i born, survives;
+                matchAvx2(localRule, count, born, survives);
+
+                // Live cells that survive, dead cells that are born
+                __m256i kept = _mm256_and_si256(self, survives);
+                __m256i next = _mm256_or_si256(kept, _mm256_andnot_si256(self, born));
+                _mm256_storeu_si256((__m256i*)(out + col), _mm256_blendv_epi8(dead, alive, next));
+
+                // The age goes up when the cell survives and resets otherwise, saturating at MAX_AGE
+                if (AGES) {
+                    __m256i* ages = (__m256i*)(age + col);
+                    _mm256_storeu_si256(ages, _mm256_and_si256(_mm256_adds_epu8(_mm256_loadu_si256(ages), one), kept));
+                }
+            }
+
+            return col;
+        }
+
+        /**
+        * SSE4.1 kernel, same as stepAvx2 but 16 cells per iteration
+        * @return the first column that was not computed
+        */
+        template <bool AGES, class R>
+        GOL_TARGET_SSE41 static int stepSse41(const R& rule, const char* above, const char* middle, const char* below, char* out, uint8_t* age, int col, int colEnd) {
+            const R localRule = rule;
+            const __m128i alive = _mm_set1_epi8('#');
+            const __m128i dead = _mm_set1_epi8('.');
+            const __m128i one = _mm_set1_epi8(1);
+
+            for (; col + 16 <= colEnd; col += 16)
+            {
+                __m128i count = _mm_setzero_si128();
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(above + col - 1)), alive));
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(above + col)), alive));
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(above + col + 1)), alive));
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(middle + col - 1)), alive));
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(middle + col + 1)), alive));
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(below + col - 1)), alive));
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(below + col)), alive));
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(below + col + 1)), alive));
+
+                /*  GOL RULES BELOW  */
+
+                __m128i self = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(middle + col)), alive);
+                __m128i born, survives;
+                matchSse41(localRule, count, born, survives);
+
+                __m128i kept = _mm_and_si128(self, survives);
+                __m128i next = _mm_or_si128(kept, _mm_andnot_si128(self, born));
+                _mm_storeu_si128((__m128i*)(out + col), _mm_blendv_epi8(dead, alive, next));
+
+                if (AGES) {
+                    __m128i* ages = (__m128i*)(age + col);
+                    _mm_storeu_si128(ages, _mm_and_si128(_mm_adds_epu8(_mm_loadu_si128(ages), one), kept));
+                }
+            }
+
+            return col;
+        }
+#endif
+
+    public:
+
+        // The kernels nextGeneration can run, all of them give the same result
+        enum class Kernel { Scalar, SSE41, AVX2, Table };
+
+        // What lies past the edges of the board
+        enum class EdgeMode { Dead, Wrap };
+
+        // Colors for colorize and nextGenerationColorized, each one packed like the pixels it's written to
+        struct Palette
+        {
+            uint32_t alive[MAX_AGE + 1]; // color of a live cell by age
+            uint32_t dead;
+        };
+
+    private:
+
+        Kernel kernel = Kernel::Scalar;
+        EdgeMode edgeMode = EdgeMode::Dead;
+
+        Rule rule; // B3/S23 unless setRule picks another one
+        std::unique_ptr<BlockTable> ruleTable; // lookup table for rules other than B3/S23
+        const BlockTable* table = &blockTable(); // lookup table the Table kernel uses
+
+        bool trackAges = true;
+
+        // True if the tile or one of its neighbors changed last generation
+        bool isTileActive(int tileRow, int tileCol) {
+            for (int i = tileRow - 1; i <= tileRow + 1; i++)
+            {
+                for (int j = tileCol - 1; j <= tileCol + 1; j++)
+                {
+                    int neighborRow = i;
+                    int neighborCol = j;
+                    if (edgeMode == EdgeMode::Wrap) {
+                        neighborRow = wrap(i, TILES_Y);
+                        neighborCol = wrap(j, TILES_X);
+                    }
+                    else if (i < 0 || i >= TILES_Y || j < 0 || j >= TILES_X) {
+                        continue;
+                    }
+
+                    if (tileChanged[neighborRow * TILES_X + neighborCol]) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /**
+        * Copies part of a board row into a scratch row, following the edge mode outside the board
+        * @param boardRow and left are the board coordinates of the first cell, they can be off the board
+        */
+        void loadScratchRow(char* dst, int boardRow, int left, int width) {
+            if (edgeMode == EdgeMode::Wrap) {
+                boardRow = wrap(boardRow, BOARDSIZE_Y);
+            }
+            else if (boardRow < 0 || boardRow >= BOARDSIZE_Y) {
+                std::memset(dst, '.', width);
+                return;
+            }
+
+            const char* src = &board[index(boardRow, 0)];
+            int c = 0;
+            while (c < width) {
+                int col = left + c;
+                if (edgeMode == EdgeMode::Wrap) {
+                    col = wrap(col, BOARDSIZE_X);
+                }
+                else if (col < 0 || col >= BOARDSIZE_X) {
+                    dst[c++] = '.';
+                    continue;
+                }
+
+                int run = std::min(width - c, BOARDSIZE_X - col);
+                std::memcpy(dst + c, src + col, run);
+                c += run;
+            }
+        }
+
+        /**
+        * Advances one tile several generations in a private buffer and writes it to boardNext
+        * The tile is loaded with a halo as wide as the number of generations, every generation
+        * the outermost ring of the halo goes stale, so after all of them only the tile is exact
+        * @param generations is the number of generations to run, also the halo width
+        */
+        template <bool AGES, class R>
+        void stepTileTemporal(const R& rule, int tileRow, int tileCol, int generations) {
+            int rowBegin = tileRow * TILE_HEIGHT;
+            int rowEnd = std::min(rowBegin + TILE_HEIGHT, (int)BOARDSIZE_Y);
+            int colBegin = tileCol * TILE_WIDTH;
+            int colEnd = std::min(colBegin + TILE_WIDTH, (int)BOARDSIZE_X);
+
+            int top = rowBegin - generations;
+            int left = colBegin - generations;
+            int height = rowEnd - rowBegin + 2 * generations;
+            int width = colEnd - colBegin + 2 * generations;
+
+            // Part of the scratch area that gets computed, with dead edges everything off the board stays dead
+            int boardTop = 0;
+            int boardBottom = height;
+            int boardLeft = 0;
+            int boardRight = width;
+            if (edgeMode == EdgeMode::Dead) {
+                boardTop = std::max(0, -top);
+                boardBottom = std::min(height, BOARDSIZE_Y - top);
+                boardLeft = std::max(0, -left);
+                boardRight = std::min(width, BOARDSIZE_X - left);
+            }
+
+            TileScratch& scratch = tileScratch.local();
+            scratch.cells.resize((size_t)width * height);
+            scratch.ages.resize((size_t)width * height);
+
+            for (int r = 0; r < height; r++)
+            {
+                loadScratchRow(&scratch.cells[(size_t)r * width], top + r, left, width);
+            }
+
+            // Only the tile's own ages are needed, other tasks write the halo's ages
+            for (int r = generations; AGES && r < height - generations; r++)
+            {
+                std::memcpy(&scratch.ages[(size_t)r * width + generations], &boardAge[index(top + r, colBegin)], colEnd - colBegin);
+            }
+
+            scratch.cellsNext = scratch.cells;
+
+            for (int t = 1; t <= generations; t++)
+            {
+                int rowFirst = std::max(t, boardTop);
+                int rowLast = std::min(height - t, boardBottom);
+                int colFirst = std::max(t, boardLeft);
+                int colLast = std::min(width - t, boardRight);
+
+                stepRows<AGES>(rule, scratch.cells.data(), scratch.cellsNext.data(), scratch.ages.data(), width, rowFirst, rowLast, colFirst, colLast);
+                scratch.cells.swap(scratch.cellsNext);
+            }
+
+            uint64_t hashChange = 0;
+            for (int r = generations; r < height - generations; r++)
+            {
+                std::memcpy(&boardNext[index(top + r, colBegin)], &scratch.cells[(size_t)r * width + generations], colEnd - colBegin);
+                if (AGES) {
+                    std::memcpy(&boardAge[index(top + r, colBegin)], &scratch.ages[(size_t)r * width + generations], colEnd - colBegin);
+                }
+                hashChange ^= hashChanges(top + r, colBegin, colEnd);
+            }
+            tileHashChange[tileRow * TILES_X + tileCol] = hashChange;
+        }
+
+        /**
+        * Computes the next generation of one tile
+        * A tile whose neighborhood didn't change can't change either, boardNext still holds
+        * the generation before which is the same, so only the ages have to move on
+        */
+        template <bool AGES, class R>
+        void stepTile(const R& rule, int tileRow, int tileCol) {
+            int rowBegin = tileRow * TILE_HEIGHT;
+            int rowEnd = std::min(rowBegin + TILE_HEIGHT, (int)BOARDSIZE_Y);
+            int colBegin = tileCol * TILE_WIDTH;
+            int colEnd = std::min(colBegin + TILE_WIDTH, (int)BOARDSIZE_X);
+
+            if (!isTileActive(tileRow, tileCol)) {
+                // Cells that survived last generation survive again
+                for (int row = rowBegin; AGES && row < rowEnd; row++)
+                {
+                    uint8_t* age = &boardAge[index(row, 0)];
+                    for (int col = colBegin; col < colEnd; col++)
+                    {
+                        age[col] += age[col] != 0 && age[col] != MAX_AGE;
+                    }
+                }
+                tileChangedNext[tileRow * TILES_X + tileCol] = 0;
+                tileHashChange[tileRow * TILES_X + tileCol] = 0;
+                return;
+            }
+
+            stepRows<AGES>(rule, &board[index(0, 0)], &boardNext[index(0, 0)], &boardAge[index(0, 0)], STRIDE, rowBegin, rowEnd, colBegin, colEnd);
+
+            bool changed = false;
+            uint64_t hashChange = 0;
+            for (int row = rowBegin; row < rowEnd; row++)
+            {
+                if (std::memcmp(&board[index(row, colBegin)], &boardNext[index(row, colBegin)], colEnd - colBegin) != 0) {
+                    changed = true;
+                    hashChange ^= hashChanges(row, colBegin, colEnd);
+                }
+            }
+            tileChangedNext[tileRow * TILES_X + tileCol] = changed;
+            tileHashChange[tileRow * TILES_X + tileCol] = hashChange;
+        }
+
+        /**
+        * Writes the colors of one tile of a buffer into pixels
+        * @param pixels has one value per cell, row by row without the ghost border
+        */
+        void colorTile(const Cells& cells, int tileRow, int tileCol, uint32_t* pixels, const Palette& palette) {
+            int rowBegin = tileRow * TILE_HEIGHT;
+            int rowEnd = std::min(rowBegin + TILE_HEIGHT, (int)BOARDSIZE_Y);
+            int colBegin = tileCol * TILE_WIDTH;
+            int colEnd = std::min(colBegin + TILE_WIDTH, (int)BOARDSIZE_X);
+
+            for (int row = rowBegin; row < rowEnd; row++)
+            {
+                const char* cell = &cells[index(row, 0)];
+                const uint8_t* age = &boardAge[index(row, 0)];
+                uint32_t* out = pixels + (size_t)row * BOARDSIZE_X;
+                for (int col = colBegin; col < colEnd; col++)
+                {
+                    out[col] = cell[col] == '#' ? palette.alive[age[col]] : palette.dead;
+                }
+            }
+        }
+
+        /**
+        * Runs stepTile over the whole board in parallel
+        * @param pixels gets the colors of the new generation written while each tile is still in cache, unless it's null
+        */
+        template <bool AGES, class R>
+        void stepTiles(const R& rule, uint32_t* pixels, const Palette* palette) {
+            tbb::parallel_for(tbb::blocked_range2d<int>(0, TILES_Y, GRAIN_Y, 0, TILES_X, GRAIN_X), [&](const tbb::blocked_range2d<int>& block)
+            {
+                // These loops are divided up across all threads
+                for (int tileRow = block.rows().begin(); tileRow < block.rows().end(); ++tileRow)
+                {
+                    for (int tileCol = block.cols().begin(); tileCol < block.cols().end(); ++tileCol)
+                    {
+                        stepTile<AGES>(rule, tileRow, tileCol);
+                        if (pixels) {
+                            colorTile(boardNext, tileRow, tileCol, pixels, *palette);
+                        }
+                    }
+                }
+            }, tilePartitioner);
+        }
+
+        // Runs stepTileTemporal over the whole board in parallel
+        template <bool AGES, class R>
+        void stepTilesTemporal(const R& rule, int generations) {
+            tbb::parallel_for(tbb::blocked_range2d<int>(0, TILES_Y, GRAIN_Y, 0, TILES_X, GRAIN_X), [&](const tbb::blocked_range2d<int>& block)
+            {
+                for (int tileRow = block.rows().begin(); tileRow < block.rows().end(); ++tileRow)
+                {
+                    for (int tileCol = block.cols().begin(); tileCol < block.cols().end(); ++tileCol)
+                    {
+                        stepTileTemporal<AGES>(rule, tileRow, tileCol, generations);
+                    }
+                }
+            }, temporalPartitioner);
+        }
 
     public:
 
-        uint16_t generation = 0; // making this public cause a getgeneration() function would be slow
+        uint64_t generation = 0; // making this public cause a getgeneration() function would be slow
 
         /* CONSTRUCTOR */
         Board(uint16_t newBOARDSIZE_X, uint16_t newBOARDSIZE_Y) {
             BOARDSIZE_X = newBOARDSIZE_X;
             BOARDSIZE_Y = newBOARDSIZE_Y;
 
-            boardAge.resize(BOARDSIZE_Y, std::vector<int>(BOARDSIZE_X));
+            STRIDE = BOARDSIZE_X + 2;
+            boardAge.assign(STRIDE * (BOARDSIZE_Y + 2), 0);
+
+            board.assign(STRIDE * (BOARDSIZE_Y + 2), '.');
+            boardNext.assign(STRIDE * (BOARDSIZE_Y + 2), '.');
+
+            TILES_X = (BOARDSIZE_X + TILE_WIDTH - 1) / TILE_WIDTH;
+            TILES_Y = (BOARDSIZE_Y + TILE_HEIGHT - 1) / TILE_HEIGHT;
+            tileChanged.assign(TILES_X * TILES_Y, 1);
+            tileChangedNext.assign(TILES_X * TILES_Y, 1);
+            tileHashChange.assign(TILES_X * TILES_Y, 0);
 
-            board.resize(BOARDSIZE_Y, std::vector<char>(BOARDSIZE_X));
+            // Use the widest kernel this CPU supports, the lookup table works everywhere
+            if (!setKernel(Kernel::AVX2) && !setKernel(Kernel::SSE41)) {
+                setKernel(Kernel::Table);
+            }
         }
 
         /**
-        * Returns a 2D vector of characters with the next generation
-        *
-        * @param board is a 2D vector of characters with the input generation
+        * Picks the kernel used by nextGeneration
+        * @param newKernel is the kernel to use, Kernel::Scalar and Kernel::Table are always available
+        * @return false if the CPU doesn't support it, the current kernel is kept then
         */
-        void nextGeneration() {
+        bool setKernel(Kernel newKernel) {
+            if ((newKernel == Kernel::AVX2 && !cpuHasAvx2()) || (newKernel == Kernel::SSE41 && !cpuHasSse41())) {
+                return false;
+            }
+            kernel = newKernel;
+            return true;
+        }
+
+        Kernel getKernel() {
+            return kernel;
+        }
+
+        /**
+        * Sets what lies past the edges, dead cells or the opposite side of the board (a torus)
+        * @param newEdgeMode is the new edge mode
+        */
+        void setEdgeMode(EdgeMode newEdgeMode) {
+            edgeMode = newEdgeMode;
+            markAllTilesChanged();
+            historyStale = true;
+        }
+
+        EdgeMode getEdgeMode() {
+            return edgeMode;
+        }
+
+        /**
+        * Sets the rule the board runs
+        * @param newRule is the new rule, B3/S23 and a few other common rules run specialized kernels
+        */
+        void setRule(const Rule& newRule) {
+            rule = newRule;
+            historyStale = true;
+            if (LifeRule::matches(rule)) {
+                ruleTable.reset();
+                table = &blockTable();
+            }
+            else {
+                ruleTable.reset(new BlockTable(rule.birth, rule.survive));
+                table = ruleTable.get();
+            }
+            markAllTilesChanged();
+        }
+
+        /**
+        * Sets the rule the board runs from a string in B/S notation
+        * @param text is the rule, like "B3/S23" or "B36/S23"
+        * @return false if the string isn't a valid rule, the current rule is kept then
+        */
+        bool setRule(const std::string& text) {
+            Rule newRule;
+            if (!Rule::parse(text, newRule)) {
+                return false;
+            }
+            setRule(newRule);
+            return true;
+        }
+
+        Rule getRule() {
+            return rule;
+        }
 
+        /**
+        * Turns age tracking on or off, without it the kernels never touch the age plane
+        * which saves memory bandwidth when nothing is drawing the board
+        * @param enabled is false to stop tracking, the ages are reset to 0 either way and count up from the next generation
+        */
+        void setAgeTracking(bool enabled) {
+            trackAges = enabled;
+            clearAges();
+        }
+
+        // Sets every age back to 0, for cells written from somewhere that doesn't know their ages
+        void clearAges() {
+            std::fill(boardAge.begin(), boardAge.end(), 0);
+            // Settled tiles only age cells that already have an age, every tile has to be recomputed once
+            markAllTilesChanged();
+        }
+
+        bool getAgeTracking() {
+            return trackAges;
+        }
+
+    private:
+
+        // Computes the next generation and colors it into pixels if they aren't null
+        void step(uint32_t* pixels, const Palette* palette) {
+
+            startHistory();
             generation++; // increment the generation
-            std::vector<std::vector<char>> boardTemp(BOARDSIZE_Y, std::vector<char>(BOARDSIZE_X));
+            refreshGhostCells();
 
-            tbb::parallel_for(tbb::blocked_range<uint16_t>(0, BOARDSIZE_Y), [&](tbb::blocked_range<uint16_t> ib)
+            // The rule and age tracking are picked here once, everything below gets them as template parameters
+            withRule(rule, [&](const auto& fixedRule)
             {
-                tbb::parallel_for(tbb::blocked_range<uint16_t>(0, BOARDSIZE_X), [&](tbb::blocked_range<uint16_t> jb)
+                if (trackAges) {
+                    stepTiles<true>(fixedRule, pixels, palette);
+                }
+                else {
+                    stepTiles<false>(fixedRule, pixels, palette);
+                }
+            });
+
+            board.swap(boardNext);
+            tileChanged.swap(tileChangedNext);
+            applyTileHashChanges();
+            recordHistory();
+        }
+
+    public:
+
+        /**
+        * Computes the next generation into boardNext and swaps it in
+        * Nothing is allocated or copied, the two buffers just trade places
+        * Tiles that didn't change and have no changed neighbors are skipped
+        */
+        void nextGeneration() {
+            step(nullptr, nullptr);
+        }
+
+        /**
+        * Computes the next generation and writes its colors in the same pass over each tile,
+        * so drawing a running simulation reads the board once per frame instead of twice
+        * @param pixels has BOARDSIZE_X * BOARDSIZE_Y values, row by row
+        * @param palette gives the colors, live cells are colored by age
+        */
+        void nextGenerationColorized(uint32_t* pixels, const Palette& palette) {
+            step(pixels, &palette);
+        }
+
+        /**
+        * Writes the colors of the current generation without stepping, for when the simulation is paused
+        * @param pixels has BOARDSIZE_X * BOARDSIZE_Y values, row by row
+        * @param palette gives the colors, live cells are colored by age
+        */
+        void colorize(uint32_t* pixels, const Palette& palette) {
+            tbb::parallel_for(tbb::blocked_range2d<int>(0, TILES_Y, GRAIN_Y, 0, TILES_X, GRAIN_X), [&](const tbb::blocked_range2d<int>& block)
+            {
+                for (int tileRow = block.rows().begin(); tileRow < block.rows().end(); ++tileRow)
                 {
-                    // These loops are divided up across all threads
-                    for (int row = ib.begin(); row < ib.end(); ++row)
+                    for (int tileCol = block.cols().begin(); tileCol < block.cols().end(); ++tileCol)
                     {
-                        for (int col = jb.begin(); col < jb.end(); ++col)
-                        {
-                            int numNeighbors = 0;
-
-                            // Check for new neighbors
-                            for (int i = -1; i <= 1; i++)
-                            {
-                                for (int j = -1; j <= 1; j++)
-                                {
-                                    // Check to make sure we're not out of bounds
-                                    if ((row + i) < BOARDSIZE_X && (col + j) < BOARDSIZE_Y) {
-                                        if ((row + i) > 0 && (col + j) > 0) {
-                                            // Check to make sure we're not on the cell itself
-                                            if (!(i == 0 && j == 0)) {
-                                                // Check to make sure the neighbor is alive
-                                                if (getCell(row + i, col + j) == '#') {
-                                                    numNeighbors++; // Add a neighbor
-                                                }
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-
-                            /*  GOL RULES BELOW  */
-
-                            // Cell dies (1 or 0 neighbors)
-                            if (numNeighbors < 2) {
-                                boardTemp[row][col] = '.';
-                                setCellAge(row, col, 0);
-                            }
-                            // Cell dies (> 3 neighbors)
-                            else if (numNeighbors > 3) {
-                                boardTemp[row][col] = '.';
-                                setCellAge(row, col, 0);
-                            }
-                            // Call grows (exactly 3 neighbors)
-                            else if (numNeighbors == 3 && getCell(row, col) == '.') {
-                                boardTemp[row][col] = '#';
-                                setCellAge(row, col, 0);
-                            }
-                            // if it's not one of these things then just up the age counter
-                            else {
-                                boardTemp[row][col] = getCell(row, col);
-                                int upAge = getCellAge(row, col);
-                                upAge++;
-                                setCellAge(row, col, upAge);
-                            }
+                        colorTile(board, tileRow, tileCol, pixels, palette);
+                    }
+                }
+            }, tilePartitioner);
+        }
+
+        /**
+        * Sets the smallest block of tiles a task works on
+        * Tiles are 128 cells wide and 64 tall, the default of 2x1 tiles makes square blocks
+        * @param rows is the number of tile rows per block
+        * @param cols is the number of tile columns per block
+        */
+        void setGrainSize(int rows, int cols) {
+            GRAIN_Y = std::max(1, rows);
+            GRAIN_X = std::max(1, cols);
+        }
+
+        /**
+        * Sets how many generations nextGenerations runs per pass over the board
+        * Deeper passes touch memory less often but recompute a wider halo around each tile
+        * @param generations is the depth, 1 turns temporal blocking off
+        */
+        void setTemporalBlocking(int generations) {
+            temporalDepth = std::max(1, std::min<int>(generations, TILE_HEIGHT));
+        }
+
+        /**
+        * Advances the board several generations
+        * Each tile is copied out with a halo and run temporalDepth generations in cache
+        * before it's written back, so the board goes through memory once per pass instead of once per generation
+        * Only the generation at the end of each pass goes in the history, so a period found here
+        * can be a multiple of the real one, nextGeneration finds the exact period
+        * @param count is the number of generations to run
+        */
+        void nextGenerations(int count) {
+            while (count > 0) {
+                int generations = std::min(count, temporalDepth);
+                count -= generations;
+
+                if (generations == 1) {
+                    nextGeneration();
+                    continue;
+                }
+
+                startHistory();
+                generation += generations;
+
+                withRule(rule, [&](const auto& fixedRule)
+                {
+                    if (trackAges) {
+                        stepTilesTemporal<true>(fixedRule, generations);
+                    }
+                    else {
+                        stepTilesTemporal<false>(fixedRule, generations);
+                    }
+                });
+
+                board.swap(boardNext);
+                applyTileHashChanges();
+                recordHistory();
+
+                // Which tiles changed in the last of those generations isn't known
+                markAllTilesChanged();
+            }
+        }
+
+        // Number of tiles that changed in the last generation
+        int changedTiles() {
+            return (int)std::count(tileChanged.begin(), tileChanged.end(), 1);
+        }
+
+        /**
+        * Saves the board, its rule, edge mode, kernel and generation to a binary snapshot
+        * Chunks of rows are packed and compressed in parallel, a sparse board takes a fraction of a bit per cell
+        * Ages aren't saved
+        * @param filename is the file to write
+        * @return false if the file couldn't be written, the error is printed
+        */
+        bool saveSnapshot(const std::string& filename) {
+            size_t rowBytes = (BOARDSIZE_X + 7) / 8;
+            int chunkCount = (BOARDSIZE_Y + SNAPSHOT_ROWS - 1) / SNAPSHOT_ROWS;
+
+            std::vector<std::vector<uint8_t>> chunks(chunkCount);
+            tbb::parallel_for(tbb::blocked_range<int>(0, chunkCount, 1), [&](tbb::blocked_range<int> ib)
+            {
+                std::vector<uint8_t> packed;
+                for (int chunk = ib.begin(); chunk < ib.end(); ++chunk)
+                {
+                    int rowBegin = chunk * SNAPSHOT_ROWS;
+                    int rowEnd = std::min(rowBegin + SNAPSHOT_ROWS, (int)BOARDSIZE_Y);
+                    packed.resize(rowBytes * (rowEnd - rowBegin));
+                    for (int row = rowBegin; row < rowEnd; row++)
+                    {
+                        packCells(&board[index(row, 0)], BOARDSIZE_X, &packed[rowBytes * (row - rowBegin)]);
+                    }
+                    compressRuns(packed.data(), packed.size(), chunks[chunk]);
+                }
+            });
+
+            SnapshotHeader header = {};
+            std::memcpy(header.magic, "GOLSNAP1", 8);
+            header.sizeX = BOARDSIZE_X;
+            header.sizeY = BOARDSIZE_Y;
+            header.generation = generation;
+            header.birth = rule.birth;
+            header.survive = rule.survive;
+            header.kernel = (uint8_t)kernel;
+            header.edgeMode = (uint8_t)edgeMode;
+            header.rowsPerChunk = SNAPSHOT_ROWS;
+            header.chunkCount = chunkCount;
+
+            std::ofstream outfile(filename, std::ios::binary);
+            outfile.write((const char*)&header, sizeof(header));
+            for (const std::vector<uint8_t>& chunk : chunks)
+            {
+                uint64_t size = chunk.size();
+                outfile.write((const char*)&size, sizeof(size));
+            }
+            for (const std::vector<uint8_t>& chunk : chunks)
+            {
+                outfile.write((const char*)chunk.data(), chunk.size());
+            }
+
+            if (!outfile) {
+                std::cerr << "Couldn't write snapshot \"" << filename << "\".\n";
+                return false;
+            }
+            return true;
+        }
+
+        /**
+        * Loads a snapshot written by saveSnapshot, the rows are unpacked in parallel straight into the board
+        * The rule, edge mode and generation come from the snapshot, the kernel too if this CPU has it
+        * Every age starts at 0 again
+        * @param filename is the file to read, it has to be for a board of the same size
+        * @return false if the file can't be read or doesn't fit this board, the board is left alone then
+        */
+        bool loadSnapshot(const std::string& filename) {
+            std::ifstream infile(filename, std::ios::binary | std::ios::ate);
+            if (!infile) {
+                std::cerr << "Couldn't open snapshot \"" << filename << "\".\n";
+                return false;
+            }
+            std::vector<uint8_t> data((size_t)infile.tellg());
+            infile.seekg(0);
+            infile.read((char*)data.data(), data.size());
+
+            SnapshotHeader header;
+            if (!infile || data.size() < sizeof(header)) {
+                std::cerr << "Snapshot \"" << filename << "\" is cut off.\n";
+                return false;
+            }
+            std::memcpy(&header, data.data(), sizeof(header));
+            if (std::memcmp(header.magic, "GOLSNAP1", 8) != 0 || header.engine != 0 || header.rowsPerChunk == 0) {
+                std::cerr << "\"" << filename << "\" isn't a board snapshot.\n";
+                return false;
+            }
+            if (header.sizeX != BOARDSIZE_X || header.sizeY != BOARDSIZE_Y) {
+                std::cerr << "Snapshot \"" << filename << "\" is " << header.sizeX << "x" << header.sizeY
+                    << " but the board is " << BOARDSIZE_X << "x" << BOARDSIZE_Y << ".\n";
+                return false;
+            }
+
+            // The chunk table has to match the board and fit in the file before anything is sized from it
+            size_t chunkCount = header.chunkCount;
+            size_t rowsPerChunk = header.rowsPerChunk;
+            if (chunkCount != (BOARDSIZE_Y + rowsPerChunk - 1) / rowsPerChunk
+                || sizeof(header) + chunkCount * sizeof(uint64_t) > data.size()) {
+                std::cerr << "\"" << filename << "\" isn't a board snapshot.\n";
+                return false;
+            }
+
+            // Where each chunk starts
+            std::vector<size_t> offsets(chunkCount + 1);
+            offsets[0] = sizeof(header) + chunkCount * sizeof(uint64_t);
+            bool valid = true;
+            for (size_t chunk = 0; valid && chunk < chunkCount; chunk++)
+            {
+                uint64_t size;
+                std::memcpy(&size, &data[sizeof(header) + chunk * sizeof(uint64_t)], sizeof(size));
+                valid = size <= data.size() - offsets[chunk];
+                offsets[chunk + 1] = offsets[chunk] + (size_t)size;
+            }
+
+            // Everything is decompressed before the board is touched, so a bad file leaves it alone
+            size_t rowBytes = (BOARDSIZE_X + 7) / 8;
+            std::vector<uint8_t> packed(valid ? rowBytes * BOARDSIZE_Y : 0);
+            std::atomic<bool> decoded(valid);
+            if (valid) {
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, chunkCount, 1), [&](tbb::blocked_range<size_t> ib)
+                {
+                    for (size_t chunk = ib.begin(); chunk < ib.end(); ++chunk)
+                    {
+                        size_t rowBegin = chunk * rowsPerChunk;
+                        size_t rowEnd = std::min(rowBegin + rowsPerChunk, (size_t)BOARDSIZE_Y);
+                        if (!decompressRuns(&data[offsets[chunk]], offsets[chunk + 1] - offsets[chunk], &packed[rowBytes * rowBegin], rowBytes * (rowEnd - rowBegin))) {
+                            decoded = false;
                         }
                     }
                 });
+            }
+            if (!decoded) {
+                std::cerr << "Snapshot \"" << filename << "\" is damaged.\n";
+                return false;
+            }
+
+            tbb::parallel_for(tbb::blocked_range<int>(0, BOARDSIZE_Y), [&](tbb::blocked_range<int> ib)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    unpackCells(&packed[rowBytes * row], BOARDSIZE_X, &board[index(row, 0)]);
+                }
             });
 
-            board = boardTemp;
+            setRule(Rule(header.birth, header.survive));
+            setEdgeMode(header.edgeMode == (uint8_t)EdgeMode::Wrap ? EdgeMode::Wrap : EdgeMode::Dead);
+            if (header.kernel <= (uint8_t)Kernel::Table) {
+                setKernel((Kernel)header.kernel);
+            }
+            generation = header.generation;
+            std::fill(boardAge.begin(), boardAge.end(), 0);
+            markAllTilesChanged();
+            rehash();
+            return true;
         }
 
         /**
-        * Loads the board form a text file
-        * The file should contain "." for dead cells and "#" for alive cells
-        * @param filename is the name of the file to read
+        * Loads an RLE pattern, the runs are written straight into the board as they're decoded
+        * The pattern is centred, a pattern bigger than the board loses the same amount off each side,
+        * and the rule comes from the file
+        * @param filename is the file to read
+        * @return false if the file can't be read, the board is cleared if the error was in the runs
         */
-        void loadFromFile(std::string filename) {
-            std::ifstream infile(filename); // .txt file containing board "." as dead and "#" as alive
+        bool loadFromRLE(const std::string& filename) {
+            RLEReader reader;
+            if (!reader.open(filename)) {
+                return false;
+            }
+            Rule patternRule;
+            if (!parsePatternRule(reader.rule, patternRule)) {
+                std::cerr << "Unknown rule \"" << reader.rule << "\" in \"" << filename << "\", using " << rule.toString() << ".\n";
+                patternRule = rule;
+            }
+            if (reader.width > BOARDSIZE_X || reader.height > BOARDSIZE_Y) {
+                std::cerr << "\"" << filename << "\" is " << reader.width << "x" << reader.height << ", the parts off the board are cut off.\n";
+            }
 
-            // Variables for reading file
-            int frow = 0;
-            int fcol = 0;
-            char c;
-            while (infile.get(c)) // read file
+            clearBoard();
+            int64_t top = ((int64_t)BOARDSIZE_Y - reader.height) / 2;
+            int64_t left = ((int64_t)BOARDSIZE_X - reader.width) / 2;
+            bool read = reader.read([&](int64_t row, int64_t col, int64_t count)
             {
-                if (c != *"\n") { // handle newlines
-                    board[frow][fcol] = c;
-                    fcol++;
+                row += top;
+                col += left;
+                int64_t begin = std::max<int64_t>(col, 0);
+                int64_t end = std::min<int64_t>(col + count, BOARDSIZE_X);
+                if (row >= 0 && row < BOARDSIZE_Y && begin < end) {
+                    std::memset(&board[index((int)row, (int)begin)], '#', (size_t)(end - begin));
                 }
-                else { // reset columns and add a row
-                    frow++;
-                    fcol = 0;
+            });
+            if (!read) {
+                // The rows before the bad run are already on the board
+                clearBoard();
+                return false;
+            }
+
+            setRule(patternRule);
+            generation = 0;
+            std::fill(boardAge.begin(), boardAge.end(), 0);
+            markAllTilesChanged();
+            rehash();
+            return true;
+        }
+
+        /**
+        * Saves the board as an RLE pattern the size of the board, so loadFromRLE puts it back in the same place
+        * @param filename is the file to write
+        * @return false if it couldn't be written, the error is printed
+        */
+        bool saveToRLE(const std::string& filename) {
+            RLEWriter writer;
+            if (!writer.open(filename, BOARDSIZE_X, BOARDSIZE_Y, rule.toString())) {
+                return false;
+            }
+
+            // Row ends are held back until the next live cell, so empty rows and trailing dead cells cost nothing
+            int64_t rowEnds = 0;
+            for (int row = 0; row < BOARDSIZE_Y; row++)
+            {
+                const char* cells = &board[index(row, 0)];
+                int col = 0;
+                while (col < BOARDSIZE_X) {
+                    const char* alive = (const char*)std::memchr(cells + col, '#', BOARDSIZE_X - col);
+                    if (!alive) {
+                        break;
+                    }
+                    int start = (int)(alive - cells);
+                    int end = start;
+                    while (end < BOARDSIZE_X && cells[end] == '#') {
+                        end++;
+                    }
+
+                    writer.add(rowEnds, '$');
+                    rowEnds = 0;
+                    writer.add(start - col, 'b');
+                    writer.add(end - start, 'o');
+                    col = end;
+                }
+                rowEnds++;
+            }
+
+            if (!writer.close()) {
+                std::cerr << "Couldn't write pattern \"" << filename << "\".\n";
+                return false;
+            }
+            return true;
+        }
+
+        /**
+        * Loads the board from a text file
+        * The file should contain "." for dead cells and "#" for alive cells, one row per line
+        * The file is mapped, the line breaks are found in one scan and the rows are decoded in parallel
+        * Short rows and missing rows are dead, anything other than "#" is dead too
+        * @param filename is the name of the file to read
+        * @return false if the file can't be read or has more rows or columns than the board, the board is left alone then
+        */
+        bool loadFromFile(const std::string& filename) {
+            MappedFile file;
+            if (!file.openReadOnly(filename)) {
+                return false;
+            }
+            const char* text = (const char*)file.getData();
+            size_t size = (size_t)file.getSize();
+
+            // Line i is text[begin, ends[i]), a last line without a break ends at the end of the file
+            std::vector<size_t> ends;
+            findLineEnds(text, size, ends);
+            if (ends.empty() || ends.back() + 1 < size) {
+                ends.push_back(size);
+            }
+            auto lineBegin = [&](size_t line) { return line == 0 ? 0 : ends[line - 1] + 1; };
+            auto lineLength = [&](size_t line)
+            {
+                size_t length = ends[line] - lineBegin(line);
+                return length > 0 && text[ends[line] - 1] == '\r' ? length - 1 : length;
+            };
+
+            // Blank lines at the end don't count as rows
+            size_t rows = ends.size();
+            while (rows > 0 && lineLength(rows - 1) == 0) {
+                rows--;
+            }
+            size_t columns = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, rows), (size_t)0, [&](tbb::blocked_range<size_t> ib, size_t widest)
+            {
+                for (size_t line = ib.begin(); line < ib.end(); ++line)
+                {
+                    widest = std::max(widest, lineLength(line));
                 }
+                return widest;
+            },
+            [](size_t a, size_t b) { return std::max(a, b); });
+
+            if (rows > BOARDSIZE_Y || columns > BOARDSIZE_X) {
+                std::cerr << "\"" << filename << "\" is " << columns << "x" << rows
+                    << " but the board is " << BOARDSIZE_X << "x" << BOARDSIZE_Y << ".\n";
+                return false;
             }
 
+            tbb::parallel_for(tbb::blocked_range<int>(0, BOARDSIZE_Y), [&](tbb::blocked_range<int> ib)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    char* cells = &board[index(row, 0)];
+                    size_t length = (size_t)row < rows ? lineLength(row) : 0;
+                    const char* line = text + ((size_t)row < rows ? lineBegin(row) : 0);
+                    for (size_t col = 0; col < length; col++)
+                    {
+                        cells[col] = line[col] == '#' ? '#' : '.';
+                    }
+                    std::memset(cells + length, '.', BOARDSIZE_X - length);
+                }
+            });
+
+            std::fill(boardAge.begin(), boardAge.end(), 0);
+            markAllTilesChanged();
+            rehash();
+            return true;
         }
 
         // Prints the board to the console
@@ -136,7 +1305,7 @@ class Board
             {
                 for (int j = 0; j < BOARDSIZE_X; j++)
                 {
-                    std::cout << board[i][j] << ' ';
+                    std::cout << board[index(i, j)] << ' ';
                 }
                 std::cout << '\n';
             }
@@ -145,44 +1314,158 @@ class Board
         }
 
         std::vector<std::vector<char>> getBoard() {
-            return board;
+            std::vector<std::vector<char>> rows(BOARDSIZE_Y);
+            for (int i = 0; i < BOARDSIZE_Y; i++)
+            {
+                rows[i].assign(board.begin() + index(i, 0), board.begin() + index(i, BOARDSIZE_X));
+            }
+            return rows;
         }
 
         std::vector<std::vector<int>> getBoardAge() {
-            return boardAge;
+            std::vector<std::vector<int>> rows(BOARDSIZE_Y);
+            for (int i = 0; i < BOARDSIZE_Y; i++)
+            {
+                rows[i].assign(boardAge.begin() + index(i, 0), boardAge.begin() + index(i, BOARDSIZE_X));
+            }
+            return rows;
+        }
+
+        uint16_t getBoardSizeX() {
+            return BOARDSIZE_X;
+        }
+
+        uint16_t getBoardSizeY() {
+            return BOARDSIZE_Y;
         }
 
         int getCellAge(int row, int col) {
-            return boardAge[row][col];
+            return boardAge[index(row, col)];
         }
 
         char getCell(int row, int col) {
-            return board[row][col];
+            return board[index(row, col)];
+        }
+
+        // The cells of a row, BOARDSIZE_X long
+        const char* getRow(int row) {
+            return &board[index(row, 0)];
+        }
+
+        /**
+        * Overwrites a whole row, only tiles that actually change are marked
+        * @param cells is BOARDSIZE_X cells long
+        */
+        void setRow(int row, const char* cells) {
+            if (row < 0 || row >= BOARDSIZE_Y) {
+                return;
+            }
+            char* dst = &board[index(row, 0)];
+            for (int col = 0; col < BOARDSIZE_X; col += TILE_WIDTH)
+            {
+                int width = std::min<int>(TILE_WIDTH, BOARDSIZE_X - col);
+                if (memcmp(dst + col, cells + col, width) != 0) {
+                    for (int c = col; c < col + width; c++)
+                    {
+                        if ((dst[c] == '#') != (cells[c] == '#')) {
+                            hash ^= cellKey(row, c);
+                            historyStale = true;
+                        }
+                    }
+                    memcpy(dst + col, cells + col, width);
+                    tileChanged[(row / TILE_HEIGHT) * TILES_X + col / TILE_WIDTH] = 1;
+                }
+            }
         }
 
         void setBoard(std::vector<std::vector<char>> newBoard) {
-            board = newBoard;
+            for (int i = 0; i < BOARDSIZE_Y && i < (int)newBoard.size(); i++)
+            {
+                for (int j = 0; j < BOARDSIZE_X && j < (int)newBoard[i].size(); j++)
+                {
+                    board[index(i, j)] = newBoard[i][j];
+                }
+            }
+            markAllTilesChanged();
+            rehash();
         }
 
         void setCell(int row, int col, char state) {
-            if (row < BOARDSIZE_X && col < BOARDSIZE_Y) {
-                if (row > 0 && col > 0) {
-                    board[row][col] = state;
+            if (row < BOARDSIZE_Y && col < BOARDSIZE_X) {
+                if (row >= 0 && col >= 0) {
+                    if ((board[index(row, col)] == '#') != (state == '#')) {
+                        hash ^= cellKey(row, col);
+                        historyStale = true;
+                    }
+                    board[index(row, col)] = state;
+                    tileChanged[(row / TILE_HEIGHT) * TILES_X + col / TILE_WIDTH] = 1;
                 }
             }
         }
 
         void setCellAge(int row, int col, int age) {
-            if (row < BOARDSIZE_X && col < BOARDSIZE_Y) {
-                if (row > 0 && col > 0) {
-                    boardAge[row][col] = age;
+            if (row < BOARDSIZE_Y && col < BOARDSIZE_X) {
+                if (row >= 0 && col >= 0) {
+                    boardAge[index(row, col)] = (uint8_t)std::max(0, std::min<int>(age, MAX_AGE));
                 }
             }
         }
 
         void clearBoard() {
-            std::vector<std::vector<char>> empty(BOARDSIZE_Y, std::vector<char>(BOARDSIZE_X));
-            board = empty;
+            std::fill(board.begin(), board.end(), '.');
+            markAllTilesChanged();
+            hash = 0;
+            historyStale = true;
+        }
+
+        // Counts the live cells
+        size_t population() {
+            return tbb::parallel_reduce(tbb::blocked_range<int>(0, BOARDSIZE_Y), (size_t)0, [&](tbb::blocked_range<int> ib, size_t count)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    const char* cell = &board[index(row, 0)];
+                    for (int col = 0; col < BOARDSIZE_X; col++)
+                    {
+                        count += cell[col] == '#';
+                    }
+                }
+                return count;
+            },
+            [](size_t a, size_t b) { return a + b; });
+        }
+
+        // Zobrist hash of the live cells, boards with the same live cells have the same hash
+        uint64_t getHash() {
+            return hash;
+        }
+
+        /**
+        * Sets how many generations the history keeps, periods up to this long are found
+        * @param generations is the number of hashes to keep, at least 1
+        */
+        void setHistoryLength(size_t generations) {
+            historyLength = std::max<size_t>(1, generations);
+            historyStale = true;
+        }
+
+        size_t getHistoryLength() {
+            return historyLength;
+        }
+
+        // True once the board has come back to a generation still in the history
+        bool isPeriodic() {
+            return cyclePeriod != 0;
+        }
+
+        // Generations between repeats, 1 for a still life, 0 if no repeat has been found
+        uint64_t getPeriod() {
+            return cyclePeriod;
+        }
+
+        // First generation of the cycle, the one that came back first
+        uint64_t getCycleStart() {
+            return cycleStart;
         }
 };
 
@@ -0,0 +1,180 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "CpuFeatures.h"
+
+// Bit packing and run length coding for saving boards, and scanning text boards
+//
+// Cells are packed 8 to a byte, bit j of byte k is cell 8 * k + j and "#" is 1.
+// Packed bytes are then run length coded PackBits style: a control byte n below 128 is followed
+// by n + 1 bytes copied as they are, n of 128 or more is followed by one byte repeated n - 125 times.
+// Empty areas are long runs of zero bytes, so sparse boards shrink a lot.
+
+/**
+* Packs cells into bits
+* @param cells is count cells, "#" is alive and anything else is dead
+* @param bits gets (count + 7) / 8 bytes
+*/
+inline void packCells(const char* cells, size_t count, uint8_t* bits) {
+    size_t i = 0;
+
+#ifdef GOL_X86
+    // SSE2 is always there on x86-64, one compare and movemask packs 16 cells
+    const __m128i alive = _mm_set1_epi8('#');
+    for (; i + 16 <= count; i += 16)
+    {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(cells + i)), alive));
+        bits[i / 8] = (uint8_t)mask;
+        bits[i / 8 + 1] = (uint8_t)(mask >> 8);
+    }
+#endif
+
+    for (; i < count; i += 8)
+    {
+        uint8_t byte = 0;
+        for (size_t j = 0; j < 8 && i + j < count; j++)
+        {
+            byte |= (uint8_t)(cells[i + j] == '#') << j;
+        }
+        bits[i / 8] = byte;
+    }
+}
+
+/**
+* Unpacks bits into cells
+* @param bits is (count + 7) / 8 bytes
+* @param cells gets count cells, "#" for set bits and "." for the rest
+*/
+inline void unpackCells(const uint8_t* bits, size_t count, char* cells) {
+
+    // The 8 cells of every possible byte
+    struct Spread
+    {
+        char cells[256][8];
+
+        Spread() {
+            for (int byte = 0; byte < 256; byte++)
+            {
+                for (int j = 0; j < 8; j++)
+                {
+                    cells[byte][j] = (byte >> j) & 1 ? '#' : '.';
+                }
+            }
+        }
+    };
+    static const Spread spread;
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        std::memcpy(cells + i, spread.cells[bits[i / 8]], 8);
+    }
+    if (i < count) {
+        std::memcpy(cells + i, spread.cells[bits[i / 8]], count - i);
+    }
+}
+
+/**
+* Run length codes bytes, the output is appended
+* @param data is size bytes
+* @param out gets the coded bytes added to its end
+*/
+inline void compressRuns(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    size_t i = 0;
+    while (i < size) {
+
+        // Repeats of 3 or more are worth a run
+        size_t run = 1;
+        while (i + run < size && run < 130 && data[i + run] == data[i]) {
+            run++;
+        }
+        if (run >= 3) {
+            out.push_back((uint8_t)(run + 125));
+            out.push_back(data[i]);
+            i += run;
+            continue;
+        }
+
+        // Otherwise copy bytes until the next run of 3
+        size_t literal = 0;
+        while (i + literal < size && literal < 128) {
+            if (i + literal + 2 < size && data[i + literal] == data[i + literal + 1] && data[i + literal] == data[i + literal + 2]) {
+                break;
+            }
+            literal++;
+        }
+        out.push_back((uint8_t)(literal - 1));
+        out.insert(out.end(), data + i, data + i + literal);
+        i += literal;
+    }
+}
+
+// Most bytes size coded bytes can decode to, every 2 bytes can be a run of at most 130
+inline uint64_t maxDecodedSize(uint64_t size) {
+    return size / 2 * 130;
+}
+
+/**
+* Decodes what compressRuns wrote
+* @param data is size coded bytes
+* @param out gets exactly outSize bytes
+* @return false if the data is cut off or doesn't decode to exactly outSize bytes
+*/
+inline bool decompressRuns(const uint8_t* data, size_t size, uint8_t* out, size_t outSize) {
+    size_t i = 0;
+    size_t o = 0;
+    while (i < size) {
+        uint8_t control = data[i++];
+        if (control < 128) {
+            size_t literal = (size_t)control + 1;
+            if (i + literal > size || o + literal > outSize) {
+                return false;
+            }
+            std::memcpy(out + o, data + i, literal);
+            i += literal;
+            o += literal;
+        }
+        else {
+            size_t run = (size_t)control - 125;
+            if (i >= size || o + run > outSize) {
+                return false;
+            }
+            std::memset(out + o, data[i++], run);
+            o += run;
+        }
+    }
+    return o == outSize;
+}
+
+/**
+* Finds every line break in a text, for splitting text boards into rows
+* @param text is size bytes
+* @param ends gets the offset of every "\n", in order
+*/
+inline void findLineEnds(const char* text, size_t size, std::vector<size_t>& ends) {
+    size_t i = 0;
+
+#ifdef GOL_X86
+    // 16 bytes per compare, most blocks of a board have no line break at all
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16)
+    {
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(text + i)), newline));
+        for (size_t j = 0; mask; j++, mask >>= 1)
+        {
+            if (mask & 1) {
+                ends.push_back(i + j);
+            }
+        }
+    }
+#endif
+
+    for (; i < size; i++)
+    {
+        if (text[i] == '\n') {
+            ends.push_back(i);
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "Board.h"
+#include "Soup.h"
+
+// Settings read from config.txt, shared by the window and the headless runner
+//
+// Every line is "name=value", lines starting with "#" are comments and spaces are ignored.
+// Names that aren't known are skipped so both programs can read the same file.
+
+struct Config
+{
+    uint16_t BOARDSIZE_X = 1000; // Board width
+    uint16_t BOARDSIZE_Y = 1000; // Board height
+    uint16_t PIXELSIZE = 1; // the size of each individual cell
+
+    uint8_t FREQUENCY_MULT = 10; // frequency multiplier for noise
+
+    bool USE_FILE = false;
+
+    bool WRAP_EDGES = false; // cells on one edge see the opposite edge as neighbors
+
+    std::string RULE = "B3/S23"; // rule in B/S notation
+    std::string PATTERN_FILE = ""; // RLE pattern to start with, empty for noise
+    std::string SNAPSHOT_FILE = "snapshot.gol"; // F5 saves the board here and F9 loads it
+    std::string RECORD_FILE = ""; // every generation the simulation runs is recorded here, empty to not record
+    uint32_t RECORD_EVERY = 1; // records every Nth generation
+    std::string REPLAY_FILE = ""; // recording to scrub through with the arrow keys, empty for none
+
+    bool FUSED_COLORIZE = false; // colors the board while computing the next generation
+
+    uint16_t GRAIN_SIZE = 64; // side of the smallest square of cells a thread colors at once
+    uint16_t TILE_GRAIN = 2; // side of the smallest square of tiles a thread simulates at once
+
+    /**
+    * Reads a config file, settings it doesn't mention keep their defaults
+    * @param filename is the file to read
+    * @return false if the file couldn't be opened, the error is printed
+    */
+    bool load(const std::string& filename) {
+        std::ifstream cFile(filename);
+        if (!cFile.is_open()) {
+            std::cerr << "Couldn't open config file for reading.\n";
+            return false;
+        }
+
+        std::string line;
+        while (getline(cFile, line)) {
+            line.erase(std::remove_if(line.begin(), line.end(), [](unsigned char c) { return std::isspace(c); }),
+                line.end());
+            if (line.empty() || line[0] == '#')
+                continue;
+            auto delimiterPos = line.find("=");
+            auto name = line.substr(0, delimiterPos);
+            auto value = delimiterPos == std::string::npos ? std::string() : line.substr(delimiterPos + 1);
+            if (name == "boardsize") {
+                BOARDSIZE_X = std::stoi(value);
+                BOARDSIZE_Y = std::stoi(value);
+            }
+            else if (name == "boardsize_x") {
+                BOARDSIZE_X = std::stoi(value);
+            }
+            else if (name == "boardsize_y") {
+                BOARDSIZE_Y = std::stoi(value);
+            }
+            else if (name == "pixelsize") {
+                PIXELSIZE = std::stoi(value);
+            }
+            else if (name == "noise_frequency") {
+                FREQUENCY_MULT = std::stoi(value);
+            }
+            else if (name == "use_file") {
+                USE_FILE = value == "true";
+            }
+            else if (name == "wrap_edges") {
+                WRAP_EDGES = value == "true";
+            }
+            else if (name == "fused_colorize") {
+                FUSED_COLORIZE = value == "true";
+            }
+            else if (name == "rule") {
+                RULE = value;
+            }
+            else if (name == "pattern_file") {
+                PATTERN_FILE = value;
+            }
+            else if (name == "record_file") {
+                RECORD_FILE = value;
+            }
+            else if (name == "record_every") {
+                RECORD_EVERY = std::max(1, std::stoi(value));
+            }
+            else if (name == "replay_file") {
+                REPLAY_FILE = value;
+            }
+            else if (name == "snapshot_file") {
+                SNAPSHOT_FILE = value;
+            }
+            else if (name == "grain_size") {
+                GRAIN_SIZE = std::max(1, std::stoi(value));
+            }
+            else if (name == "tile_grain") {
+                TILE_GRAIN = std::stoi(value);
+            }
+        }
+        return true;
+    }
+
+    /**
+    * Sets a board's edge mode, rule and grain size from the config
+    * @param board is the board to set up, it should already be BOARDSIZE_X x BOARDSIZE_Y
+    */
+    void configureBoard(Board& board) const {
+        if (WRAP_EDGES) {
+            board.setEdgeMode(Board::EdgeMode::Wrap);
+        }
+        if (!board.setRule(RULE)) {
+            std::cerr << "Invalid rule \"" << RULE << "\" in config file, using B3/S23.\n";
+        }
+        // Tiles are twice as wide as they are tall
+        board.setGrainSize(TILE_GRAIN, (TILE_GRAIN + 1) / 2);
+    }
+
+    /**
+    * Fills a board with its starting cells, from Board.txt, the pattern file or noise
+    * @param board is the board to fill
+    * @param noise is used when there's no file
+    */
+    void seedBoard(Board& board, const FastNoise& noise) const {
+        if (USE_FILE) {
+            // Load the txt file
+            board.loadFromFile("Board.txt");
+        }
+        else if (!PATTERN_FILE.empty()) {
+            // Load an RLE pattern, the rule in the file replaces the one above
+            board.loadFromRLE(PATTERN_FILE);
+        }
+        else {
+            // Generate a board with FastNoise
+            fillNoise(noise, BOARDSIZE_X, BOARDSIZE_Y, FREQUENCY_MULT, randomNoiseOffset(), [&](int y, int x, bool alive)
+            {
+                board.setCell(y, x, alive ? '#' : '.');
+            });
+        }
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+// Runtime CPU feature checks used to pick the SIMD kernels
+//
+// Kernels for an instruction set are marked with GOL_TARGET_AVX2 or GOL_TARGET_SSE41
+// so GCC and Clang build them without the whole program needing -mavx2,
+// MSVC allows the intrinsics anywhere so the macros are empty there
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GOL_X86 1
+#endif
+
+#ifdef GOL_X86
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define GOL_TARGET_AVX2
+#define GOL_TARGET_SSE41
+#define GOL_FLATTEN
+#else
+#define GOL_TARGET_AVX2 __attribute__((target("avx2")))
+#define GOL_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define GOL_FLATTEN __attribute__((flatten)) // inlines everything the kernel calls, so generic code on SIMD types gets the target too
+#endif
+
+#include <immintrin.h>
+
+#endif
+
+// Returns true if the CPU and OS support AVX2
+inline bool cpuHasAvx2() {
+#if !defined(GOL_X86)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    // AVX needs the OS to save the YMM registers
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Returns true if the CPU supports SSE4.1
+inline bool cpuHasSse41() {
+#if !defined(GOL_X86)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
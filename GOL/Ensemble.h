@@ -0,0 +1,391 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/cache_aligned_allocator.h>
+
+#include "CpuFeatures.h"
+#include "Board.h"
+#include "PackedBoard.h"
+#include "Soup.h"
+
+// Many small boards of the same size stepped together, for running lots of random soups
+//
+// Each cell is one Word and bit i of every word belongs to board i, so one lifeWord call
+// steps the same cell of every board. uint64_t runs 64 boards and Lanes256 runs 256 with AVX2.
+// Like PackedBoard this only runs B3/S23.
+
+// 256 lanes in an AVX2 register, check cpuHasAvx2 before stepping with it. Only ensembleRow uses
+// the AVX2 operators, loading, reading and counting work on any CPU
+struct alignas(32) Lanes256
+{
+    uint64_t lanes[4];
+};
+
+#ifdef GOL_X86
+
+GOL_TARGET_AVX2 inline Lanes256 operator&(const Lanes256& a, const Lanes256& b) {
+    Lanes256 r;
+    _mm256_store_si256((__m256i*)r.lanes, _mm256_and_si256(_mm256_load_si256((const __m256i*)a.lanes), _mm256_load_si256((const __m256i*)b.lanes)));
+    return r;
+}
+
+GOL_TARGET_AVX2 inline Lanes256 operator|(const Lanes256& a, const Lanes256& b) {
+    Lanes256 r;
+    _mm256_store_si256((__m256i*)r.lanes, _mm256_or_si256(_mm256_load_si256((const __m256i*)a.lanes), _mm256_load_si256((const __m256i*)b.lanes)));
+    return r;
+}
+
+GOL_TARGET_AVX2 inline Lanes256 operator^(const Lanes256& a, const Lanes256& b) {
+    Lanes256 r;
+    _mm256_store_si256((__m256i*)r.lanes, _mm256_xor_si256(_mm256_load_si256((const __m256i*)a.lanes), _mm256_load_si256((const __m256i*)b.lanes)));
+    return r;
+}
+
+GOL_TARGET_AVX2 inline Lanes256 operator~(const Lanes256& a) {
+    Lanes256 r;
+    __m256i v = _mm256_load_si256((const __m256i*)a.lanes);
+    _mm256_store_si256((__m256i*)r.lanes, _mm256_xor_si256(v, _mm256_cmpeq_epi64(v, v)));
+    return r;
+}
+
+#else
+
+inline Lanes256 operator&(const Lanes256& a, const Lanes256& b) {
+    return { { a.lanes[0] & b.lanes[0], a.lanes[1] & b.lanes[1], a.lanes[2] & b.lanes[2], a.lanes[3] & b.lanes[3] } };
+}
+
+inline Lanes256 operator|(const Lanes256& a, const Lanes256& b) {
+    return { { a.lanes[0] | b.lanes[0], a.lanes[1] | b.lanes[1], a.lanes[2] | b.lanes[2], a.lanes[3] | b.lanes[3] } };
+}
+
+inline Lanes256 operator^(const Lanes256& a, const Lanes256& b) {
+    return { { a.lanes[0] ^ b.lanes[0], a.lanes[1] ^ b.lanes[1], a.lanes[2] ^ b.lanes[2], a.lanes[3] ^ b.lanes[3] } };
+}
+
+inline Lanes256 operator~(const Lanes256& a) {
+    return { { ~a.lanes[0], ~a.lanes[1], ~a.lanes[2], ~a.lanes[3] } };
+}
+
+#endif
+
+// 64 lanes of a word, k picks which 64
+inline uint64_t laneBits(const uint64_t& word, int) {
+    return word;
+}
+
+inline uint64_t laneBits(const Lanes256& word, int k) {
+    return word.lanes[k];
+}
+
+inline uint64_t& laneBits(uint64_t& word, int) {
+    return word;
+}
+
+inline uint64_t& laneBits(Lanes256& word, int k) {
+    return word.lanes[k];
+}
+
+// a |= b 64 lanes at a time, kept off the Lanes256 operators so it runs without AVX2
+template <typename Word>
+inline void orLanes(Word& a, const Word& b) {
+    for (int k = 0; k < (int)(sizeof(Word) / sizeof(uint64_t)); k++)
+    {
+        laneBits(a, k) |= laneBits(b, k);
+    }
+}
+
+/**
+* Steps one row of cells, every lane at once
+* The rows have a ghost cell on each side, so cols + 2 words are read from each
+* @return the lanes with a live cell in the new row
+*/
+template <class Word>
+inline Word ensembleRow(const Word* above, const Word* middle, const Word* below, Word* out, int cols) {
+    Word any = Word();
+    for (int c = 1; c <= cols; c++)
+    {
+        out[c] = lifeWord(above[c - 1], above[c], above[c + 1], middle[c - 1], middle[c], middle[c + 1], below[c - 1], below[c], below[c + 1]);
+        any = any | out[c];
+    }
+    return any;
+}
+
+#ifdef GOL_X86
+
+// Same as above, built for AVX2 with lifeWord and the Lanes256 operators inlined
+GOL_TARGET_AVX2 GOL_FLATTEN inline Lanes256 ensembleRow(const Lanes256* above, const Lanes256* middle, const Lanes256* below, Lanes256* out, int cols) {
+    Lanes256 any = Lanes256();
+    for (int c = 1; c <= cols; c++)
+    {
+        out[c] = lifeWord(above[c - 1], above[c], above[c + 1], middle[c - 1], middle[c], middle[c + 1], below[c - 1], below[c], below[c + 1]);
+        any = any | out[c];
+    }
+    return any;
+}
+
+#endif
+
+template <class Word>
+class EnsembleBoard
+{
+    private:
+
+        typedef std::vector<Word, tbb::cache_aligned_allocator<Word>> Words;
+
+        uint16_t BOARDSIZE_Y = 20;
+        uint16_t BOARDSIZE_X = 20;
+        size_t STRIDE = 22; // length of a stored row, the board plus a ghost cell on each side
+
+        Board::EdgeMode edgeMode = Board::EdgeMode::Dead;
+        Words board; // one word per cell surrounded by a ghost border like Board
+        Words boardNext;
+        std::vector<int64_t> extinctions; // generation each board was first seen empty, -1 while it has live cells
+
+        size_t index(int row, int col) {
+            return (row + 1) * STRIDE + col + 1;
+        }
+
+        // Fills the ghost border, with dead cells or with the opposite edge
+        void refreshGhostCells() {
+            bool wrap = edgeMode == Board::EdgeMode::Wrap;
+            for (int row = 0; row < BOARDSIZE_Y; row++)
+            {
+                board[index(row, -1)] = wrap ? board[index(row, BOARDSIZE_X - 1)] : Word();
+                board[index(row, BOARDSIZE_X)] = wrap ? board[index(row, 0)] : Word();
+            }
+            for (size_t col = 0; col < STRIDE; col++)
+            {
+                board[col] = wrap ? board[BOARDSIZE_Y * STRIDE + col] : Word();
+                board[(BOARDSIZE_Y + 1) * STRIDE + col] = wrap ? board[STRIDE + col] : Word();
+            }
+        }
+
+        // Edits can bring boards back to life
+        void resetExtinctions() {
+            std::fill(extinctions.begin(), extinctions.end(), -1);
+        }
+
+    public:
+
+        enum { LANES = sizeof(Word) * 8 }; // number of boards
+
+        uint64_t generation = 0;
+
+        /* CONSTRUCTOR */
+        EnsembleBoard(uint16_t newBOARDSIZE_X, uint16_t newBOARDSIZE_Y) {
+            BOARDSIZE_X = newBOARDSIZE_X;
+            BOARDSIZE_Y = newBOARDSIZE_Y;
+            STRIDE = BOARDSIZE_X + 2;
+
+            board.assign(STRIDE * (BOARDSIZE_Y + 2), Word());
+            boardNext.assign(STRIDE * (BOARDSIZE_Y + 2), Word());
+            extinctions.assign(LANES, -1);
+        }
+
+        void setEdgeMode(Board::EdgeMode newEdgeMode) {
+            edgeMode = newEdgeMode;
+        }
+
+        Board::EdgeMode getEdgeMode() {
+            return edgeMode;
+        }
+
+        /**
+        * Computes the next generation of every board
+        * Boards that have no live cells left get their extinction generation set
+        */
+        void nextGeneration() {
+
+            generation++; // increment the generation
+
+            refreshGhostCells();
+
+            Word alive = tbb::parallel_reduce(tbb::blocked_range<int>(0, BOARDSIZE_Y), Word(), [&](tbb::blocked_range<int> ib, const Word& found)
+            {
+                Word any = found;
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    orLanes(any, ensembleRow(&board[index(row - 1, -1)], &board[index(row, -1)], &board[index(row + 1, -1)], &boardNext[index(row, -1)], BOARDSIZE_X));
+                }
+                return any;
+            },
+            [](Word a, const Word& b)
+            {
+                orLanes(a, b);
+                return a;
+            });
+
+            board.swap(boardNext);
+
+            for (int lane = 0; lane < LANES; lane++)
+            {
+                if (extinctions[lane] < 0 && ((laneBits(alive, lane / 64) >> (lane % 64)) & 1) == 0) {
+                    extinctions[lane] = (int64_t)generation;
+                }
+            }
+        }
+
+        /**
+        * Fills every board with a different noise soup
+        * @param frequency scales the noise like noise_frequency in the config, higher gives smaller blobs
+        * @param seed picks the soups, board i uses noise seed seed + i
+        */
+        void fillNoise(int frequency, int seed) {
+
+            // Lanes share words, so each soup is made on its own and then packed in by row
+            std::vector<std::vector<char>> soups(LANES, std::vector<char>(BOARDSIZE_X * BOARDSIZE_Y));
+            tbb::parallel_for(tbb::blocked_range<int>(0, LANES), [&](tbb::blocked_range<int> ib)
+            {
+                for (int lane = ib.begin(); lane < ib.end(); ++lane)
+                {
+                    FastNoise noise = soupNoise(seed + lane);
+                    ::fillNoise(noise, BOARDSIZE_X, BOARDSIZE_Y, frequency, 1 + lane, [&](int row, int col, bool alive)
+                    {
+                        soups[lane][row * BOARDSIZE_X + col] = alive;
+                    });
+                }
+            });
+
+            tbb::parallel_for(tbb::blocked_range<int>(0, BOARDSIZE_Y), [&](tbb::blocked_range<int> ib)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    for (int col = 0; col < BOARDSIZE_X; col++)
+                    {
+                        Word cell = Word();
+                        for (int lane = 0; lane < LANES; lane++)
+                        {
+                            laneBits(cell, lane / 64) |= (uint64_t)soups[lane][row * BOARDSIZE_X + col] << (lane % 64);
+                        }
+                        board[index(row, col)] = cell;
+                    }
+                }
+            });
+            resetExtinctions();
+        }
+
+        // Live cells of every board, index i is board i
+        std::vector<uint64_t> population() {
+            return tbb::parallel_reduce(tbb::blocked_range<int>(0, BOARDSIZE_Y), std::vector<uint64_t>(LANES, 0),
+                [&](tbb::blocked_range<int> ib, std::vector<uint64_t> counts)
+                {
+                    // Bit sliced counters, plane k holds bit k of every lane's count
+                    std::vector<Word> planes;
+                    for (int row = ib.begin(); row < ib.end(); ++row)
+                    {
+                        for (int col = 0; col < BOARDSIZE_X; col++)
+                        {
+                            Word carry = board[index(row, col)];
+                            for (size_t k = 0; ; k++)
+                            {
+                                bool done = true;
+                                for (int part = 0; part < LANES / 64; part++)
+                                {
+                                    done = done && laneBits(carry, part) == 0;
+                                }
+                                if (done) {
+                                    break;
+                                }
+                                if (k == planes.size()) {
+                                    planes.push_back(Word());
+                                }
+                                for (int part = 0; part < LANES / 64; part++)
+                                {
+                                    uint64_t& plane = laneBits(planes[k], part);
+                                    uint64_t& bits = laneBits(carry, part);
+                                    uint64_t sum = plane ^ bits;
+                                    bits &= plane;
+                                    plane = sum;
+                                }
+                            }
+                        }
+                    }
+
+                    for (int lane = 0; lane < LANES; lane++)
+                    {
+                        for (size_t k = 0; k < planes.size(); k++)
+                        {
+                            counts[lane] += ((laneBits(planes[k], lane / 64) >> (lane % 64)) & 1) << k;
+                        }
+                    }
+                    return counts;
+                },
+                [](std::vector<uint64_t> a, const std::vector<uint64_t>& b)
+                {
+                    for (size_t i = 0; i < a.size(); i++)
+                    {
+                        a[i] += b[i];
+                    }
+                    return a;
+                });
+        }
+
+        // Generation each board was first seen empty after a step, -1 for boards that still have live cells
+        const std::vector<int64_t>& getExtinctions() {
+            return extinctions;
+        }
+
+        // Number of boards that haven't died out
+        int survivors() {
+            return (int)std::count(extinctions.begin(), extinctions.end(), -1);
+        }
+
+        char getCell(int lane, int row, int col) {
+            return (laneBits(board[index(row, col)], lane / 64) >> (lane % 64)) & 1 ? '#' : '.';
+        }
+
+        void setCell(int lane, int row, int col, char state) {
+            if (lane >= 0 && lane < LANES && row >= 0 && row < BOARDSIZE_Y && col >= 0 && col < BOARDSIZE_X) {
+                uint64_t& bits = laneBits(board[index(row, col)], lane / 64);
+                uint64_t bit = 1ull << (lane % 64);
+                bits = state == '#' ? bits | bit : bits & ~bit;
+                extinctions[lane] = -1;
+            }
+        }
+
+        /**
+        * Copies a char board into one of the boards
+        * @param lane is the board to write
+        * @param source is the board to read, "#" is alive and anything else is dead
+        */
+        void loadFromBoard(int lane, Board& source) {
+            for (int row = 0; row < BOARDSIZE_Y; row++)
+            {
+                for (int col = 0; col < BOARDSIZE_X; col++)
+                {
+                    bool inside = row < source.getBoardSizeY() && col < source.getBoardSizeX();
+                    setCell(lane, row, col, inside ? source.getCell(row, col) : '.');
+                }
+            }
+        }
+
+        // Writes one of the boards into a char board
+        void storeToBoard(int lane, Board& target) {
+            int rows = std::min<int>(BOARDSIZE_Y, target.getBoardSizeY());
+            int cols = std::min<int>(BOARDSIZE_X, target.getBoardSizeX());
+            for (int row = 0; row < rows; row++)
+            {
+                for (int col = 0; col < cols; col++)
+                {
+                    target.setCell(row, col, getCell(lane, row, col));
+                }
+            }
+        }
+
+        uint16_t getBoardSizeX() {
+            return BOARDSIZE_X;
+        }
+
+        uint16_t getBoardSizeY() {
+            return BOARDSIZE_Y;
+        }
+
+        void clearBoard() {
+            std::fill(board.begin(), board.end(), Word());
+            resetExtinctions();
+        }
+};
@@ -8,19 +8,26 @@
 #include <chrono>
 #include <thread>
 #include <algorithm>    // std::for_each
+#include <cstring>
 #include <tbb/blocked_range.h>
+#include <tbb/blocked_range2d.h>
 #include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/Graphics/Font.hpp>
 
+#ifdef _WIN32
 #include <Windows.h> // Must be imported after SFML (otherwise it causes problems with "Rect")
+#endif
 
-#include "FastNoise.h"
+#include "Soup.h"
 
 #include "rgbhsv.h"
 #include "Board.h"
+#include "Recording.h"
+#include "Config.h"
 
 // Game of Life CPP
 // Author: Nathan Laha
@@ -66,96 +73,65 @@ sf::View getLetterboxView(sf::View view, int windowWidth, int windowHeight) {
     return view;
 }
 
+// Packs a color into 4 bytes in the R, G, B, A order SFML textures use
+uint32_t packColor(sf::Color color) {
+    sf::Uint8 bytes[4] = { color.r, color.g, color.b, color.a };
+    uint32_t packed;
+    std::memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
+
+// Builds the colors for the fused colorize pass, live cells fade from newC to oldC over 5 generations
+void buildPalette(Board::Palette& palette, sf::Color newC, sf::Color oldC, sf::Color deadColor) {
+    for (int age = 0; age < (int)(sizeof(palette.alive) / sizeof(palette.alive[0])); age++)
+    {
+        // Make the cool lifetime color vis thing
+        double t = (double)age / (double)5;
+
+        if (t > 1) {
+            t = 1;
+        }
+
+        sf::Color output(0, 0, 0);
+
+        output.r = RgbToHsv(newC).r * (1 - t) + RgbToHsv(oldC).r * t;
+        output.g = RgbToHsv(newC).g * (1 - t) + RgbToHsv(oldC).g * t;
+        output.b = RgbToHsv(newC).b * (1 - t) + RgbToHsv(oldC).b * t;
+
+        palette.alive[age] = packColor(HsvToRgb(output));
+    }
+    palette.dead = packColor(deadColor);
+}
+
 /* MAIN */
 int main()
 {
-    uint16_t BOARDSIZE_X = 1000; // Board width
-    uint16_t BOARDSIZE_Y = 1000; // Board height
-    uint16_t PIXELSIZE = 1; // the size of each individual cell
-
     sf::Color NEW_COLOR = sf::Color::Blue;
     sf::Color OLD_COLOR = sf::Color::Red;
     sf::Color DEAD_CELL_COLOR = sf::Color::Black;
 
     uint8_t BRUSH_SIZE = 2; // starting size of interactive brush
 
-    uint8_t FREQUENCY_MULT = 10; // frequency multiplier for noise
-
-    bool USE_FILE = false;
-
     // Read config file
-    std::ifstream cFile("config.txt");
-    if (cFile.is_open())
-    {
-        std::string line;
-        while (getline(cFile, line)) {
-            line.erase(std::remove_if(line.begin(), line.end(), isspace),
-                line.end());
-            if (line[0] == '#' || line.empty())
-                continue;
-            auto delimiterPos = line.find("=");
-            auto name = line.substr(0, delimiterPos);
-            auto value = line.substr(delimiterPos + 1);
-            if (name == "boardsize") {
-                BOARDSIZE_X = std::stoi(value);
-                BOARDSIZE_Y = std::stoi(value);
-            }
-            else if (name == "pixelsize") {
-                PIXELSIZE = std::stoi(value);
-            }
-            else if (name == "noise_frequency") {
-                FREQUENCY_MULT = std::stoi(value);
-            }
-            else if (name == "use_file") {
-                if (value == "true") {
-                    USE_FILE = true;
-                } else {
-                    USE_FILE = false; 
-                }
-            }
-        }
+    Config config;
+    config.load("config.txt");
 
-    }
-    else {
-        std::cerr << "Couldn't open config file for reading.\n";
-    }
-
-    Board mainBoard(BOARDSIZE_X, BOARDSIZE_Y);
+    Board mainBoard(config.BOARDSIZE_X, config.BOARDSIZE_Y);
+    config.configureBoard(mainBoard);
 
-    FastNoise noise; // Create a FastNoise object
-    noise.SetNoiseType(FastNoise::SimplexFractal); // Set the desired noise type
-
-    if (USE_FILE) {
-        // Load the txt file
-        mainBoard.loadFromFile("Board.txt");
-    }
-    else {
-        // Generate a board with FastNoise
-        int noffset = 1 + (rand() % 10000); // random noise offset
-        for (int x = 0; x < BOARDSIZE_X; x++)
-        {
-            for (int y = 0; y < BOARDSIZE_Y; y++)
-            {
-                if (noise.GetNoise(x * FREQUENCY_MULT + noffset, y * FREQUENCY_MULT + noffset) > 0) {
-                    mainBoard.setCell(x, y, '#');
-                }
-                else {
-                    mainBoard.setCell(x, y, '.');
-                }
-            }
-        }
-    }
+    FastNoise noise = soupNoise(); // Create a FastNoise object
+    config.seedBoard(mainBoard, noise);
 
     // Init SFML
     sf::ContextSettings settings;
     settings.antialiasingLevel = 0;
-    sf::RenderWindow window(sf::VideoMode(PIXELSIZE * BOARDSIZE_X, PIXELSIZE * BOARDSIZE_Y + 50), "Game of Life", sf::Style::Default, settings);
+    sf::RenderWindow window(sf::VideoMode(config.PIXELSIZE * config.BOARDSIZE_X, config.PIXELSIZE * config.BOARDSIZE_Y + 50), "Game of Life", sf::Style::Default, settings);
 
     // Make an SFML view
     sf::View view;
-    view.setSize(PIXELSIZE * BOARDSIZE_X, PIXELSIZE * BOARDSIZE_Y + 50);
+    view.setSize(config.PIXELSIZE * config.BOARDSIZE_X, config.PIXELSIZE * config.BOARDSIZE_Y + 50);
     view.setCenter(view.getSize().x / 2, view.getSize().y / 2);
-    view = getLetterboxView(view, PIXELSIZE * BOARDSIZE_X, PIXELSIZE * BOARDSIZE_Y);
+    view = getLetterboxView(view, config.PIXELSIZE * config.BOARDSIZE_X, config.PIXELSIZE * config.BOARDSIZE_Y);
 
     // Load font for below UI elements
     sf::Font font;
@@ -173,7 +149,7 @@ int main()
     clearText.setString("Clear");
     clearText.setFillColor(sf::Color::White);
     clearText.setCharacterSize(20);
-    clearText.setPosition(50.0f, (BOARDSIZE_Y * PIXELSIZE) + 2.0f);
+    clearText.setPosition(50.0f, (config.BOARDSIZE_Y * config.PIXELSIZE) + 2.0f);
 
     sf::Text fillText; // fills with noise
     fillText.setStyle(sf::Text::Bold);
@@ -181,7 +157,7 @@ int main()
     fillText.setString("Fill");
     fillText.setFillColor(sf::Color::White);
     fillText.setCharacterSize(20);
-    fillText.setPosition(130.0f, (BOARDSIZE_Y * PIXELSIZE) + 2.0f);
+    fillText.setPosition(130.0f, (config.BOARDSIZE_Y * config.PIXELSIZE) + 2.0f);
 
     sf::Text randColorText; // sets the colors to a new random one
     randColorText.setStyle(sf::Text::Bold);
@@ -190,7 +166,7 @@ int main()
     randColorText.setFillColor(sf::Color::White);
     randColorText.setCharacterSize(20);
 
-    randColorText.setPosition(190.0f, (BOARDSIZE_Y * PIXELSIZE) + 2.0f);
+    randColorText.setPosition(190.0f, (config.BOARDSIZE_Y * config.PIXELSIZE) + 2.0f);
 
     // Brush size text
     sf::Text bsizeText; // shows brush size
@@ -199,7 +175,7 @@ int main()
     bsizeText.setString("BSize: " + std::to_string(BRUSH_SIZE));
     bsizeText.setFillColor(sf::Color::White);
     bsizeText.setCharacterSize(15);
-    bsizeText.setPosition(300.0f, (BOARDSIZE_Y * PIXELSIZE) + 2.0f);
+    bsizeText.setPosition(300.0f, (config.BOARDSIZE_Y * config.PIXELSIZE) + 2.0f);
 
     // Generations text
     sf::Text genText; // shows generations
@@ -208,7 +184,7 @@ int main()
     genText.setString("Generations: " + std::to_string(mainBoard.generation));
     genText.setFillColor(sf::Color::White);
     genText.setCharacterSize(15);
-    genText.setPosition(300.0f, (BOARDSIZE_Y * PIXELSIZE) + 15.0f);
+    genText.setPosition(300.0f, (config.BOARDSIZE_Y * config.PIXELSIZE) + 15.0f);
 
     // Sim delay text
     sf::Text simdText; // shows simulation delay
@@ -217,18 +193,18 @@ int main()
     simdText.setString("Simulation Delay: " + std::to_string(0));
     simdText.setFillColor(sf::Color::White);
     simdText.setCharacterSize(15);
-    simdText.setPosition(300.0f, (BOARDSIZE_Y * PIXELSIZE) + 28.0f);
+    simdText.setPosition(300.0f, (config.BOARDSIZE_Y * config.PIXELSIZE) + 28.0f);
 
     // New color preview
     sf::RectangleShape newcolPreview;
     newcolPreview.setSize(sf::Vector2f(40, 20));
-    newcolPreview.setPosition(0, (BOARDSIZE_Y * PIXELSIZE));
+    newcolPreview.setPosition(0, (config.BOARDSIZE_Y * config.PIXELSIZE));
     newcolPreview.setFillColor(NEW_COLOR);
 
     // Old color preview
     sf::RectangleShape oldcolPreview;
     oldcolPreview.setSize(sf::Vector2f(40, 20));
-    oldcolPreview.setPosition(0, (BOARDSIZE_Y * PIXELSIZE) + 20.0f);
+    oldcolPreview.setPosition(0, (config.BOARDSIZE_Y * config.PIXELSIZE) + 20.0f);
     oldcolPreview.setFillColor(OLD_COLOR);
     
     // Local vars before the main loop
@@ -240,9 +216,19 @@ int main()
     // stop/start sim
     bool simRunning = false;
 
+    // Records the run in the background, starting with the board as it is now
+    Recorder recorder;
+    if (!config.RECORD_FILE.empty() && recorder.open(config.RECORD_FILE, mainBoard, config.RECORD_EVERY)) {
+        recorder.record(mainBoard);
+    }
+
+    // Shows a recording instead, the arrow keys move through it a generation at a time
+    Replay replay;
+    bool replaying = !config.REPLAY_FILE.empty() && replay.open(config.REPLAY_FILE, mainBoard.getBoardSizeX(), mainBoard.getBoardSizeY()) && replay.seek(replay.getFirstGeneration(), mainBoard);
+
     // Responsive scaling
-    int windowWidth = BOARDSIZE_X * PIXELSIZE;
-    int windowHeight = BOARDSIZE_Y * PIXELSIZE;
+    int windowWidth = config.BOARDSIZE_X * config.PIXELSIZE;
+    int windowHeight = config.BOARDSIZE_Y * config.PIXELSIZE;
 
     // make sure we don't press the button multiple times by holding down left click
     bool btnup = true; 
@@ -252,7 +238,7 @@ int main()
     // Buffer
     sf::Texture buffer;
     buffer.setSmooth(false);
-    if (!buffer.create(BOARDSIZE_X * PIXELSIZE, BOARDSIZE_Y * PIXELSIZE))
+    if (!buffer.create(config.BOARDSIZE_X * config.PIXELSIZE, config.BOARDSIZE_Y * config.PIXELSIZE))
     {
         // error...
         std::cerr << "Error creating buffer texture";
@@ -260,7 +246,18 @@ int main()
     }
 
     sf::Image image;
-    image.create(BOARDSIZE_X * PIXELSIZE, BOARDSIZE_Y * PIXELSIZE, sf::Color::Black);
+    image.create(config.BOARDSIZE_X * config.PIXELSIZE, config.BOARDSIZE_Y * config.PIXELSIZE, sf::Color::Black);
+
+    // Hands each thread the same part of the image every frame
+    tbb::affinity_partitioner colorPartitioner;
+
+    // Pixels and colors for the fused colorize pass
+    std::vector<uint32_t> pixels;
+    Board::Palette palette;
+    if (config.FUSED_COLORIZE) {
+        pixels.assign((size_t)config.BOARDSIZE_X * config.BOARDSIZE_Y, packColor(DEAD_CELL_COLOR));
+        buildPalette(palette, newC, oldC, DEAD_CELL_COLOR);
+    }
 
     // Window Update
     while (window.isOpen())
@@ -302,6 +299,34 @@ int main()
                 windowHeight = event.size.height;
             }
 
+            // Save and load a snapshot
+            if (event.type == sf::Event::KeyPressed) {
+                if (event.key.code == sf::Keyboard::F5) {
+                    mainBoard.saveSnapshot(config.SNAPSHOT_FILE);
+                }
+                else if (event.key.code == sf::Keyboard::F9) {
+                    mainBoard.loadSnapshot(config.SNAPSHOT_FILE);
+                }
+            }
+
+            // Scrub the replay, shift jumps a key frame interval at a time
+            if (replaying && event.type == sf::Event::KeyPressed) {
+                uint64_t generation = mainBoard.generation;
+                uint64_t jump = event.key.shift ? replay.getKeyframeInterval() : 1;
+                if (event.key.code == sf::Keyboard::Left) {
+                    replay.seek(generation > jump ? generation - jump : 0, mainBoard);
+                }
+                else if (event.key.code == sf::Keyboard::Right) {
+                    replay.seek(generation + jump, mainBoard);
+                }
+                else if (event.key.code == sf::Keyboard::Home) {
+                    replay.seek(replay.getFirstGeneration(), mainBoard);
+                }
+                else if (event.key.code == sf::Keyboard::End) {
+                    replay.seek(replay.getLastGeneration(), mainBoard);
+                }
+            }
+
             // Play and pause simulation
             if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space))
             {
@@ -320,10 +345,17 @@ int main()
         // get mouse position
         sf::Vector2i position = sf::Mouse::getPosition(window);
 
-        double ccol = floor(position.y + ((windowHeight - (BOARDSIZE_Y * PIXELSIZE)) / 2)) / PIXELSIZE;
-        double crow = floor(position.x - ((windowWidth - (BOARDSIZE_X * PIXELSIZE)) / 2)) / PIXELSIZE;
+        double crow = floor(position.y + ((windowHeight - (config.BOARDSIZE_Y * config.PIXELSIZE)) / 2)) / config.PIXELSIZE;
+        double ccol = floor(position.x - ((windowWidth - (config.BOARDSIZE_X * config.PIXELSIZE)) / 2)) / config.PIXELSIZE;
 
-        genText.setString("Generations: " + std::to_string(mainBoard.generation));
+        std::string genString = "Generations: " + std::to_string(mainBoard.generation);
+        if (mainBoard.isPeriodic()) {
+            genString += " (period " + std::to_string(mainBoard.getPeriod()) + " since " + std::to_string(mainBoard.getCycleStart()) + ")";
+        }
+        if (replaying) {
+            genString += " / " + std::to_string(replay.getLastGeneration());
+        }
+        genText.setString(genString);
 
         if (sf::Mouse::isButtonPressed(sf::Mouse::Left))
         {
@@ -349,19 +381,10 @@ int main()
                     // fill with noise
                     if (fillbounds.contains(mouse))
                     {
-                        int noffset = 1 + (rand() % 10000); // random noise offset
-                        for (int x = 0; x < BOARDSIZE_X; x++)
+                        fillNoise(noise, config.BOARDSIZE_X, config.BOARDSIZE_Y, config.FREQUENCY_MULT, randomNoiseOffset(), [&](int y, int x, bool alive)
                         {
-                            for (int y = 0; y < BOARDSIZE_Y; y++)
-                            {
-                                if (noise.GetNoise(x * FREQUENCY_MULT + noffset, y * FREQUENCY_MULT + noffset) > 0) {
-                                    mainBoard.setCell(x, y, '#');
-                                }
-                                else {
-                                    mainBoard.setCell(x, y, '.');
-                                }
-                            }
-                        }
+                            mainBoard.setCell(y, x, alive ? '#' : '.');
+                        });
                     }
 
                     // clear the board
@@ -382,6 +405,10 @@ int main()
 
                         oldcolPreview.setFillColor(oldC);
                         newcolPreview.setFillColor(newC);
+
+                        if (config.FUSED_COLORIZE) {
+                            buildPalette(palette, newC, oldC, DEAD_CELL_COLOR);
+                        }
                         
                     }
                 }
@@ -392,7 +419,7 @@ int main()
                 {
                     for (int j = -1 * bsize; j <= 1 * bsize; j++)
                     {
-                        mainBoard.setCell(crow + i, ccol + j, '#');
+                        mainBoard.setCell(crow + j, ccol + i, '#');
                     }
                 }
             }
@@ -404,15 +431,23 @@ int main()
         // Get Start Time
         std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
 
-        // Create the board with quads and run the loop in parallel across all threads
-        tbb::parallel_for(tbb::blocked_range<uint16_t>(0, BOARDSIZE_Y), [&](tbb::blocked_range<uint16_t> ib)
-        {
-            tbb::parallel_for(tbb::blocked_range<uint16_t>(0, BOARDSIZE_X), [&](tbb::blocked_range<uint16_t> jb)
+        if (config.FUSED_COLORIZE) {
+            // The next generation is colored while it's computed, a paused board just gets colored
+            if (simRunning == true) {
+                mainBoard.nextGenerationColorized(pixels.data(), palette);
+            }
+            else {
+                mainBoard.colorize(pixels.data(), palette);
+            }
+        }
+        else {
+            // Create the board with quads and run the loop in parallel across all threads
+            tbb::parallel_for(tbb::blocked_range2d<int>(0, config.BOARDSIZE_Y, config.GRAIN_SIZE, 0, config.BOARDSIZE_X, config.GRAIN_SIZE), [&](const tbb::blocked_range2d<int>& block)
             {
                 // These loops are divided up across all threads
-                for (int i = ib.begin(); i < ib.end(); ++i)
+                for (int i = block.rows().begin(); i < block.rows().end(); ++i)
                 {
-                    for (int j = jb.begin(); j < jb.end(); ++j)
+                    for (int j = block.cols().begin(); j < block.cols().end(); ++j)
                     {
                         // only draw if cell is alive
                         if (mainBoard.getCell(i, j) == '#') {
@@ -423,7 +458,7 @@ int main()
                             if (t > 1) {
                                 t = 1;
                             }
-                            
+                        
                             sf::Color output(0, 0, 0);
 
                             output.r = RgbToHsv(newC).r * (1 - t) + RgbToHsv(oldC).r * t;
@@ -432,19 +467,19 @@ int main()
 
                             output = HsvToRgb(output);
 
-                            image.setPixel(i, j, output);
+                            image.setPixel(j, i, output); // i is the row so it's the y coordinate
 
                         }
                         else {
 
                             // Color the dead cells
-                            image.setPixel(i, j, DEAD_CELL_COLOR);
+                            image.setPixel(j, i, DEAD_CELL_COLOR);
 
                         }
                     }
                 }
-            });
-        });
+            }, colorPartitioner);
+        }
 
         // Get End Time
         auto end = std::chrono::system_clock::now();
@@ -455,11 +490,16 @@ int main()
         // Get Start Time
         std::chrono::system_clock::time_point start2 = std::chrono::system_clock::now();
 
-        buffer.update(image);
+        if (config.FUSED_COLORIZE) {
+            buffer.update((const sf::Uint8*)pixels.data(), config.BOARDSIZE_X, config.BOARDSIZE_Y, 0, 0);
+        }
+        else {
+            buffer.update(image);
+        }
 
         sf::Sprite bufsprite;
         bufsprite.setTexture(buffer);
-        bufsprite.setScale(PIXELSIZE, PIXELSIZE);
+        bufsprite.setScale(config.PIXELSIZE, config.PIXELSIZE);
 
         // Letterbox it for widescreen
         window.setView(view);
@@ -491,10 +531,13 @@ int main()
         // Get Start Time
         std::chrono::system_clock::time_point start3 = std::chrono::system_clock::now();
 
-        // advance the simulation
-        if (simRunning == true) {
+        // advance the simulation, the fused pass already did
+        if (simRunning == true && !config.FUSED_COLORIZE) {
             mainBoard.nextGeneration();
         }
+        if (simRunning == true) {
+            recorder.record(mainBoard);
+        }
 
         // Get End Time
         auto end3 = std::chrono::system_clock::now();
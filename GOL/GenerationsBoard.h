@@ -0,0 +1,360 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/cache_aligned_allocator.h>
+
+#include "Board.h"
+#include "Rule.h"
+
+// Board for Generations rules like Brian's Brain (B2/S/3) or Star Wars (B2/S345/4)
+//
+// State 0 is dead, 1 is alive and 2 to states - 1 are dying. Only live cells count as neighbors,
+// a live cell that doesn't survive starts dying and a dying cell moves one state on every
+// generation until it's dead again.
+//
+// The states are bit sliced like PackedBoard, plane k holds bit k of every cell's state
+// so a 3 state rule takes 2 bits per cell and every word steps 64 cells at once.
+
+class GenerationsBoard
+{
+    private:
+
+        typedef std::vector<uint64_t, tbb::cache_aligned_allocator<uint64_t>> Words;
+
+        enum { MAX_PLANES = 8 }; // enough for 256 states
+
+        uint16_t BOARDSIZE_Y = 20;
+        uint16_t BOARDSIZE_X = 20;
+        size_t ROW_WORDS = 1; // number of 64 bit words in a row of one plane
+        uint64_t LAST_WORD_MASK = ~0ull; // valid cells in the last word of a row
+
+        GenerationsRule rule;
+        int PLANES = 2; // bits per cell
+        std::vector<int> birthCounts; // neighbor counts that give a birth
+        std::vector<int> surviveCounts; // neighbor counts a live cell survives with
+
+        std::vector<Words> planes; // plane k holds bit k of the states, laid out like PackedBoard
+        std::vector<Words> planesNext; // the next generation is written here and then swapped in
+        Words alive; // cells in state 1, rebuilt from the planes every generation
+
+        /**
+        * Marks the cells whose neighbor count is one of counts
+        * @param c1, c2, c4 and c8 are the bits of the neighbor count
+        */
+        static uint64_t countIn(const std::vector<int>& counts, uint64_t c1, uint64_t c2, uint64_t c4, uint64_t c8) {
+            uint64_t match = 0;
+            for (int n : counts)
+            {
+                match |= (n & 1 ? c1 : ~c1) & (n & 2 ? c2 : ~c2) & (n & 4 ? c4 : ~c4) & (n & 8 ? c8 : ~c8);
+            }
+            return match;
+        }
+
+        // Cells in state 1 in one word of the planes
+        uint64_t aliveWord(size_t offset) const {
+            uint64_t word = planes[0][offset];
+            for (int p = 1; p < PLANES; p++)
+            {
+                word &= ~planes[p][offset];
+            }
+            return word;
+        }
+
+        // A word of the alive plane, 0 outside the board
+        uint64_t aliveAt(int row, long long word) const {
+            if (row < 0 || row >= BOARDSIZE_Y || word < 0 || word >= (long long)ROW_WORDS) {
+                return 0;
+            }
+            return alive[row * ROW_WORDS + word];
+        }
+
+        // Computes one word of the next generation
+        void stepWord(int row, size_t k) {
+            uint64_t a[3], m[3], b[3]; // previous, current and next word of the live cells in each row
+            for (int j = 0; j < 3; j++)
+            {
+                a[j] = aliveAt(row - 1, (long long)k + j - 1);
+                m[j] = aliveAt(row, (long long)k + j - 1);
+                b[j] = aliveAt(row + 1, (long long)k + j - 1);
+            }
+
+            uint64_t nw = (a[1] << 1) | (a[0] >> 63), n = a[1], ne = (a[1] >> 1) | (a[2] << 63);
+            uint64_t w = (m[1] << 1) | (m[0] >> 63), e = (m[1] >> 1) | (m[2] << 63);
+            uint64_t sw = (b[1] << 1) | (b[0] >> 63), s = b[1], se = (b[1] >> 1) | (b[2] << 63);
+
+            // Rows above and below add up to 0-3 each, the middle row to 0-2
+            uint64_t above1 = nw ^ n ^ ne;
+            uint64_t above2 = (nw & n) | ((nw ^ n) & ne);
+            uint64_t below1 = sw ^ s ^ se;
+            uint64_t below2 = (sw & s) | ((sw ^ s) & se);
+            uint64_t middle1 = w ^ e;
+            uint64_t middle2 = w & e;
+
+            // above + below
+            uint64_t sum1 = above1 ^ below1;
+            uint64_t carry1 = above1 & below1;
+            uint64_t sum2 = above2 ^ below2 ^ carry1;
+            uint64_t sum4 = (above2 & below2) | (carry1 & (above2 ^ below2));
+
+            // + middle, which gives the 4 bit neighbor count c8 c4 c2 c1
+            uint64_t c1 = sum1 ^ middle1;
+            uint64_t carry2 = sum1 & middle1;
+            uint64_t c2 = sum2 ^ middle2 ^ carry2;
+            uint64_t carry4 = (sum2 & middle2) | (carry2 & (sum2 ^ middle2));
+            uint64_t c4 = sum4 ^ carry4;
+            uint64_t c8 = sum4 & carry4;
+
+            size_t offset = row * ROW_WORDS + k;
+            uint64_t state[MAX_PLANES];
+            uint64_t any = 0;
+            for (int p = 0; p < PLANES; p++)
+            {
+                state[p] = planes[p][offset];
+                any |= state[p];
+            }
+            uint64_t live = m[1];
+            uint64_t dead = ~any;
+            uint64_t dying = any & ~live;
+
+            /*  GOL RULES BELOW  */
+
+            uint64_t born = dead & countIn(birthCounts, c1, c2, c4, c8);
+            uint64_t survives = live & countIn(surviveCounts, c1, c2, c4, c8);
+            uint64_t starts = live & ~survives;
+
+            // Dying cells count up one state, a ripple carry through the planes
+            uint64_t carry = dying;
+            for (int p = 0; p < PLANES; p++)
+            {
+                uint64_t bit = state[p];
+                state[p] = (bit ^ carry) & dying;
+                carry &= bit;
+            }
+
+            // Dying cells that reached the state count are dead
+            uint64_t finished = dying;
+            for (int p = 0; p < PLANES; p++)
+            {
+                finished &= (rule.states >> p) & 1 ? state[p] : ~state[p];
+            }
+
+            // Live cells that don't survive go to state 2, with only 2 states they're just dead
+            uint64_t toState2 = rule.states > 2 ? starts : 0;
+            for (int p = 0; p < PLANES; p++)
+            {
+                uint64_t next = state[p] & ~finished;
+                if (p == 0) {
+                    next |= born | survives;
+                }
+                if (p == 1) {
+                    next |= toState2;
+                }
+
+                // Keep the padding past the right edge dead
+                if (k + 1 == ROW_WORDS) {
+                    next &= LAST_WORD_MASK;
+                }
+                planesNext[p][offset] = next;
+            }
+        }
+
+    public:
+
+        uint64_t generation = 0;
+
+        /* CONSTRUCTOR */
+        GenerationsBoard(uint16_t newBOARDSIZE_X, uint16_t newBOARDSIZE_Y) {
+            BOARDSIZE_X = newBOARDSIZE_X;
+            BOARDSIZE_Y = newBOARDSIZE_Y;
+
+            ROW_WORDS = (BOARDSIZE_X + 63) / 64;
+            if (BOARDSIZE_X % 64 != 0) {
+                LAST_WORD_MASK = (1ull << (BOARDSIZE_X % 64)) - 1;
+            }
+
+            GenerationsRule briansBrain;
+            GenerationsRule::parse("B2/S/3", briansBrain);
+            setRule(briansBrain);
+        }
+
+        /**
+        * Sets the rule, the board is cleared because the number of states can change
+        * @param newRule is the new rule
+        */
+        void setRule(const GenerationsRule& newRule) {
+            rule = newRule;
+
+            birthCounts.clear();
+            surviveCounts.clear();
+            for (int n = 0; n <= 8; n++)
+            {
+                if (rule.rule.born(n)) {
+                    birthCounts.push_back(n);
+                }
+                if (rule.rule.survives(n)) {
+                    surviveCounts.push_back(n);
+                }
+            }
+
+            PLANES = 1;
+            while ((1 << PLANES) < rule.states) {
+                PLANES++;
+            }
+            planes.assign(PLANES, Words(ROW_WORDS * BOARDSIZE_Y, 0));
+            planesNext.assign(PLANES, Words(ROW_WORDS * BOARDSIZE_Y, 0));
+            alive.assign(ROW_WORDS * BOARDSIZE_Y, 0);
+        }
+
+        /**
+        * Sets the rule from a string in B/S/C notation
+        * @param text is the rule, like "B2/S/3" for Brian's Brain or "B2/S345/4" for Star Wars
+        * @return false if the string isn't a valid rule, the current rule and board are kept then
+        */
+        bool setRule(const std::string& text) {
+            GenerationsRule newRule;
+            if (!GenerationsRule::parse(text, newRule)) {
+                return false;
+            }
+            setRule(newRule);
+            return true;
+        }
+
+        GenerationsRule getRule() {
+            return rule;
+        }
+
+        /**
+        * Computes the next generation 64 cells at a time
+        * Cells outside the board are treated as dead
+        */
+        void nextGeneration() {
+
+            generation++; // increment the generation
+
+            // Only live cells count as neighbors, so those are pulled out of the planes first
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, alive.size()), [&](tbb::blocked_range<size_t> ib)
+            {
+                for (size_t i = ib.begin(); i < ib.end(); ++i)
+                {
+                    alive[i] = aliveWord(i);
+                }
+            });
+
+            tbb::parallel_for(tbb::blocked_range<int>(0, BOARDSIZE_Y), [&](tbb::blocked_range<int> ib)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    for (size_t k = 0; k < ROW_WORDS; k++)
+                    {
+                        stepWord(row, k);
+                    }
+                }
+            });
+
+            planes.swap(planesNext);
+        }
+
+        /**
+        * Copies the live cells of a char board into this one, everything else is dead
+        * @param source is the board to read, "#" is alive
+        */
+        void loadFromBoard(Board& source) {
+            generation = source.generation;
+            clearBoard();
+
+            int rows = std::min<int>(BOARDSIZE_Y, source.getBoardSizeY());
+            int cols = std::min<int>(BOARDSIZE_X, source.getBoardSizeX());
+            for (int row = 0; row < rows; row++)
+            {
+                for (int col = 0; col < cols; col++)
+                {
+                    if (source.getCell(row, col) == '#') {
+                        setCell(row, col, 1);
+                    }
+                }
+            }
+        }
+
+        /**
+        * Writes the live cells into a char board, dying cells are written as dead
+        * @param target is the board to write
+        */
+        void storeToBoard(Board& target) {
+            target.generation = generation;
+
+            int rows = std::min<int>(BOARDSIZE_Y, target.getBoardSizeY());
+            int cols = std::min<int>(BOARDSIZE_X, target.getBoardSizeX());
+            for (int row = 0; row < rows; row++)
+            {
+                for (int col = 0; col < cols; col++)
+                {
+                    target.setCell(row, col, getCell(row, col) == 1 ? '#' : '.');
+                }
+            }
+        }
+
+        // Counts the live cells, dying cells aren't included
+        size_t population() {
+            size_t count = 0;
+            for (int row = 0; row < BOARDSIZE_Y; row++)
+            {
+                for (size_t k = 0; k < ROW_WORDS; k++)
+                {
+                    for (uint64_t word = aliveWord(row * ROW_WORDS + k); word; word &= word - 1) {
+                        count++;
+                    }
+                }
+            }
+            return count;
+        }
+
+        // State of a cell, 0 is dead, 1 is alive and anything higher is dying
+        int getCell(int row, int col) {
+            size_t offset = row * ROW_WORDS + col / 64;
+            int state = 0;
+            for (int p = 0; p < PLANES; p++)
+            {
+                state |= (int)((planes[p][offset] >> (col % 64)) & 1) << p;
+            }
+            return state;
+        }
+
+        void setCell(int row, int col, int state) {
+            if (row >= 0 && row < BOARDSIZE_Y && col >= 0 && col < BOARDSIZE_X && state >= 0 && state < rule.states) {
+                size_t offset = row * ROW_WORDS + col / 64;
+                uint64_t bit = 1ull << (col % 64);
+                for (int p = 0; p < PLANES; p++)
+                {
+                    if ((state >> p) & 1) {
+                        planes[p][offset] |= bit;
+                    }
+                    else {
+                        planes[p][offset] &= ~bit;
+                    }
+                }
+            }
+        }
+
+        int getStateCount() {
+            return rule.states;
+        }
+
+        uint16_t getBoardSizeX() {
+            return BOARDSIZE_X;
+        }
+
+        uint16_t getBoardSizeY() {
+            return BOARDSIZE_Y;
+        }
+
+        void clearBoard() {
+            for (Words& plane : planes)
+            {
+                std::fill(plane.begin(), plane.end(), 0);
+            }
+        }
+};
@@ -0,0 +1,716 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#include "Board.h"
+#include "Pattern.h"
+
+// HashLife engine
+//
+// The plane is a quadtree where identical squares are stored once (hash consing)
+// and every square remembers its own future, so repeating patterns are computed once
+// and the board can jump 2^k generations in a single call.
+// Cells outside the tree are dead, the plane is unbounded.
+
+class HashLife
+{
+    private:
+
+        struct Node
+        {
+            Node* nw; // children, null for single cells
+            Node* ne;
+            Node* sw;
+            Node* se;
+            Node* result; // centre square advanced 2^resultLog2 generations, null until computed
+            Node* next; // next node in the same hash bucket
+            uint64_t population;
+            uint8_t level; // the node is a 2^level square
+            uint8_t resultLog2; // step the result was computed for
+            bool marked; // used by the garbage collector
+        };
+
+        enum { NODES_PER_BLOCK = 1 << 16 };
+
+        std::vector<std::unique_ptr<Node[]>> blocks; // node storage, nodes never move
+        Node* freeNodes = nullptr; // singly linked through next
+        size_t usedNodes = 0;
+        size_t maxNodes = ((size_t)1 << 30) / sizeof(Node); // default cap of 1 GB
+
+        std::vector<Node*> buckets; // hash table of every live node
+        std::vector<Node*> emptyNodes; // empty square of each level
+
+        Node deadCell = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, 0, 0, true };
+        Node aliveCell = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 1, 0, 0, true };
+
+        Node* root = nullptr;
+        int stepLog2 = 0; // the current step advances a node 2^min(stepLog2, level - 2) generations
+
+        static size_t hashChildren(Node* nw, Node* ne, Node* sw, Node* se) {
+            size_t h = (size_t)nw;
+            h = h * 1000003 ^ (size_t)ne;
+            h = h * 1000003 ^ (size_t)sw;
+            h = h * 1000003 ^ (size_t)se;
+            return h ^ (h >> 17);
+        }
+
+        Node* allocateNode() {
+            if (!freeNodes) {
+                blocks.emplace_back(new Node[NODES_PER_BLOCK]);
+                Node* block = blocks.back().get();
+                for (size_t i = 0; i < NODES_PER_BLOCK; i++)
+                {
+                    block[i].next = freeNodes;
+                    freeNodes = &block[i];
+                }
+            }
+            Node* node = freeNodes;
+            freeNodes = node->next;
+            usedNodes++;
+            return node;
+        }
+
+        void rehash(size_t newSize) {
+            std::vector<Node*> newBuckets(newSize, nullptr);
+            for (Node* head : buckets)
+            {
+                while (head) {
+                    Node* node = head;
+                    head = head->next;
+                    size_t b = hashChildren(node->nw, node->ne, node->sw, node->se) & (newSize - 1);
+                    node->next = newBuckets[b];
+                    newBuckets[b] = node;
+                }
+            }
+            buckets.swap(newBuckets);
+        }
+
+        /**
+        * Returns the unique node with these four children, creating it if needed
+        */
+        Node* join(Node* nw, Node* ne, Node* sw, Node* se) {
+            size_t b = hashChildren(nw, ne, sw, se) & (buckets.size() - 1);
+            for (Node* node = buckets[b]; node; node = node->next)
+            {
+                if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se) {
+                    return node;
+                }
+            }
+
+            Node* node = allocateNode();
+            node->nw = nw;
+            node->ne = ne;
+            node->sw = sw;
+            node->se = se;
+            node->result = nullptr;
+            node->resultLog2 = 0;
+            node->population = nw->population + ne->population + sw->population + se->population;
+            node->level = nw->level + 1;
+            node->marked = false;
+            node->next = buckets[b];
+            buckets[b] = node;
+
+            if (usedNodes > buckets.size()) {
+                rehash(buckets.size() * 2);
+            }
+            return node;
+        }
+
+        Node* emptyNode(int level) {
+            while ((int)emptyNodes.size() <= level) {
+                Node* e = emptyNodes.back();
+                emptyNodes.push_back(join(e, e, e, e));
+            }
+            return emptyNodes[level];
+        }
+
+        // Centre square of a node, one level down
+        Node* centre(Node* n) {
+            return join(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+        }
+
+        // Squares straddling two children, one level down
+        Node* centreHorizontal(Node* w, Node* e) {
+            return join(w->ne, e->nw, w->se, e->sw);
+        }
+
+        Node* centreVertical(Node* n, Node* s) {
+            return join(n->sw, n->se, s->nw, s->ne);
+        }
+
+        // Surrounds a node with empty space so the root doubles in size around the same centre
+        Node* expand(Node* n) {
+            Node* e = emptyNode(n->level - 1);
+            return join(join(e, e, e, n->nw), join(e, e, n->ne, e),
+                        join(e, n->sw, e, e), join(n->se, e, e, e));
+        }
+
+        // Reads a cell of a level 2 node, x and y are 0 to 3
+        static int cellOf(Node* n, int x, int y) {
+            Node* quad = y < 2 ? (x < 2 ? n->nw : n->ne) : (x < 2 ? n->sw : n->se);
+            Node* cell = (y & 1) ? ((x & 1) ? quad->se : quad->sw) : ((x & 1) ? quad->ne : quad->nw);
+            return (int)cell->population;
+        }
+
+        /**
+        * Runs one generation on a 4x4 square and returns the 2x2 centre
+        */
+        Node* baseResult(Node* n) {
+            Node* out[4];
+            for (int i = 0; i < 4; i++)
+            {
+                int x = 1 + (i & 1);
+                int y = 1 + (i >> 1);
+                int numNeighbors = 0;
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        if (dx != 0 || dy != 0) {
+                            numNeighbors += cellOf(n, x + dx, y + dy);
+                        }
+                    }
+                }
+
+                /*  GOL RULES BELOW  */
+                bool alive = numNeighbors == 3 || (numNeighbors == 2 && cellOf(n, x, y));
+                out[i] = alive ? &aliveCell : &deadCell;
+            }
+            return join(out[0], out[1], out[2], out[3]);
+        }
+
+        /**
+        * Returns the centre of a node advanced 2^min(stepLog2, level - 2) generations
+        * Results are cached in the node with the step they were computed for, nodes small enough
+        * to run at full speed share their result between every step size
+        */
+        Node* successor(Node* n) {
+            int resultLog2 = std::min(stepLog2, n->level - 2);
+            if (n->result && n->resultLog2 == resultLog2) {
+                return n->result;
+            }
+            if (n->population == 0) {
+                return n->nw;
+            }
+            n->resultLog2 = (uint8_t)resultLog2; // set first, nothing below reads n
+            if (n->level == 2) {
+                return n->result = baseResult(n);
+            }
+
+            // The nine overlapping squares one level down
+            Node* n00 = n->nw;
+            Node* n01 = centreHorizontal(n->nw, n->ne);
+            Node* n02 = n->ne;
+            Node* n10 = centreVertical(n->nw, n->sw);
+            Node* n11 = centre(n);
+            Node* n12 = centreVertical(n->ne, n->se);
+            Node* n20 = n->sw;
+            Node* n21 = centreHorizontal(n->sw, n->se);
+            Node* n22 = n->se;
+
+            Node* r[9];
+            bool fullSpeed = stepLog2 >= n->level - 2;
+            Node* parts[9] = { n00, n01, n02, n10, n11, n12, n20, n21, n22 };
+            for (int i = 0; i < 9; i++)
+            {
+                // At full speed both halves advance, otherwise only the second one does
+                r[i] = fullSpeed ? successor(parts[i]) : centre(parts[i]);
+            }
+
+            Node* result = join(
+                successor(join(r[0], r[1], r[3], r[4])),
+                successor(join(r[1], r[2], r[4], r[5])),
+                successor(join(r[3], r[4], r[6], r[7])),
+                successor(join(r[4], r[5], r[7], r[8])));
+            return n->result = result;
+        }
+
+        void mark(Node* n) {
+            if (n->marked) {
+                return;
+            }
+            n->marked = true;
+            if (n->level > 0) {
+                mark(n->nw);
+                mark(n->ne);
+                mark(n->sw);
+                mark(n->se);
+            }
+        }
+
+        /**
+        * Frees every node that isn't part of the current pattern
+        * Cached results of the surviving nodes are kept when they survive too
+        */
+        void collectGarbage() {
+            for (Node* e : emptyNodes)
+            {
+                mark(e);
+            }
+            mark(root);
+
+            for (Node*& head : buckets)
+            {
+                Node** link = &head;
+                while (*link) {
+                    Node* node = *link;
+                    if (node->marked) {
+                        link = &node->next;
+                    }
+                    else {
+                        *link = node->next;
+                        node->next = freeNodes;
+                        freeNodes = node;
+                        usedNodes--;
+                    }
+                }
+            }
+
+            // Drop results that pointed at freed nodes and clear the marks for next time
+            for (Node* head : buckets)
+            {
+                for (Node* node = head; node; node = node->next)
+                {
+                    if (node->result && !node->result->marked) {
+                        node->result = nullptr;
+                    }
+                }
+            }
+            for (Node* head : buckets)
+            {
+                for (Node* node = head; node; node = node->next)
+                {
+                    node->marked = false;
+                }
+            }
+        }
+
+        // Builds the node covering a 2^level square whose top left corner is (x, y) from a board
+        Node* buildFromBoard(Board& source, int level, int64_t x, int64_t y) {
+            int64_t size = (int64_t)1 << level;
+            if (x >= source.getBoardSizeX() || y >= source.getBoardSizeY() || x + size <= 0 || y + size <= 0) {
+                return emptyNode(level);
+            }
+            if (level == 0) {
+                return source.getCell((int)y, (int)x) == '#' ? &aliveCell : &deadCell;
+            }
+            int64_t half = size / 2;
+            return join(buildFromBoard(source, level - 1, x, y), buildFromBoard(source, level - 1, x + half, y),
+                        buildFromBoard(source, level - 1, x, y + half), buildFromBoard(source, level - 1, x + half, y + half));
+        }
+
+        // Writes the live cells of a node whose top left corner is (x, y) into a board
+        void storeNode(Board& target, Node* n, int64_t x, int64_t y) {
+            int64_t size = (int64_t)1 << n->level;
+            if (n->population == 0 || x >= target.getBoardSizeX() || y >= target.getBoardSizeY() || x + size <= 0 || y + size <= 0) {
+                return;
+            }
+            if (n->level == 0) {
+                target.setCell((int)y, (int)x, '#');
+                return;
+            }
+            int64_t half = size / 2;
+            storeNode(target, n->nw, x, y);
+            storeNode(target, n->ne, x + half, y);
+            storeNode(target, n->sw, x, y + half);
+            storeNode(target, n->se, x + half, y + half);
+        }
+
+        // Level 3 node of an 8x8 square, bit 8 * y + x is the cell at (x, y)
+        Node* leafNode(uint64_t bits) {
+            Node* quads[4];
+            for (int q = 0; q < 4; q++)
+            {
+                Node* cells[4];
+                for (int c = 0; c < 4; c++)
+                {
+                    int x = (q & 1) * 4 + (c & 1) * 2;
+                    int y = (q >> 1) * 4 + (c >> 1) * 2;
+                    int bit = 8 * y + x;
+                    cells[c] = join((bits >> bit) & 1 ? &aliveCell : &deadCell, (bits >> (bit + 1)) & 1 ? &aliveCell : &deadCell,
+                                    (bits >> (bit + 8)) & 1 ? &aliveCell : &deadCell, (bits >> (bit + 9)) & 1 ? &aliveCell : &deadCell);
+                }
+                quads[q] = join(cells[0], cells[1], cells[2], cells[3]);
+            }
+            return join(quads[0], quads[1], quads[2], quads[3]);
+        }
+
+        // The other way around, the 64 cells of a level 3 node
+        static uint64_t leafBits(Node* n, int x = 0, int y = 0) {
+            if (n->population == 0) {
+                return 0;
+            }
+            if (n->level == 0) {
+                return 1ull << (8 * y + x);
+            }
+            int half = 1 << (n->level - 1);
+            return leafBits(n->nw, x, y) | leafBits(n->ne, x + half, y) | leafBits(n->sw, x, y + half) | leafBits(n->se, x + half, y + half);
+        }
+
+        // Numbers the nodes under n children first for a macrocell file, empty nodes are 0 and aren't written
+        // Leaves are 8x8, a smaller node is written as a leaf with its cells in the top left corner
+        void writeMacrocellNode(std::ostream& out, Node* n, std::unordered_map<Node*, uint64_t>& numbers) {
+            if (n->population == 0 || numbers.count(n)) {
+                return;
+            }
+            if (n->level <= 3) {
+                uint64_t bits = leafBits(n);
+                std::string line;
+                for (int y = 0; y < 8 && (bits >> (8 * y)); y++)
+                {
+                    uint64_t row = (bits >> (8 * y)) & 0xFF;
+                    for (int x = 0; row >> x; x++)
+                    {
+                        line += (row >> x) & 1 ? '*' : '.';
+                    }
+                    line += '$';
+                }
+                out << line << '\n';
+            }
+            else {
+                Node* children[4] = { n->nw, n->ne, n->sw, n->se };
+                for (Node* child : children)
+                {
+                    writeMacrocellNode(out, child, numbers);
+                }
+                out << (int)n->level;
+                for (Node* child : children)
+                {
+                    out << ' ' << (child->population ? numbers[child] : 0);
+                }
+                out << '\n';
+            }
+            uint64_t number = numbers.size() + 1;
+            numbers[n] = number;
+        }
+
+        // Top left corner of the root, the root is always centred on (0, 0)
+        int64_t rootOrigin() {
+            return -((int64_t)1 << (root->level - 1));
+        }
+
+    public:
+
+        uint64_t generation = 0;
+
+        /* CONSTRUCTOR */
+        HashLife() {
+            buckets.assign(1 << 16, nullptr);
+            emptyNodes.push_back(&deadCell);
+            root = emptyNode(3);
+        }
+
+        // Nodes point at deadCell and aliveCell so the engine can't be copied or moved
+        HashLife(const HashLife&) = delete;
+        HashLife& operator=(const HashLife&) = delete;
+
+        /**
+        * Sets how much memory the node cache may use
+        * The limit is only checked between steps, nodes that aren't part of the pattern are freed when it's exceeded,
+        * so a single large step can go past it while it runs
+        * @param bytes is the memory cap
+        */
+        void setMemoryLimit(size_t bytes) {
+            maxNodes = std::max<size_t>(bytes / sizeof(Node), (size_t)NODES_PER_BLOCK);
+        }
+
+        size_t getMemoryUsage() {
+            return usedNodes * sizeof(Node) + buckets.size() * sizeof(Node*);
+        }
+
+        size_t nodeCount() {
+            return usedNodes;
+        }
+
+        /**
+        * Advances the pattern 2^k generations
+        * The memory limit is checked once the step is done, not while it runs
+        * @param k is the log2 of the number of generations
+        */
+        void step(int k) {
+            stepLog2 = k;
+
+            // Grow until the pattern sits in the centre quarter with room to travel 2^k cells
+            while (root->level < k + 3 || centre(centre(root))->population != root->population) {
+                root = expand(root);
+            }
+
+            root = successor(root);
+            generation += (uint64_t)1 << k;
+
+            if (usedNodes > maxNodes) {
+                collectGarbage();
+            }
+        }
+
+        /**
+        * Advances the pattern any number of generations, one power of two at a time
+        * @param generations is the number of generations to run
+        */
+        void advance(uint64_t generations) {
+            for (int k = 0; generations; k++, generations >>= 1)
+            {
+                if (generations & 1) {
+                    step(k);
+                }
+            }
+        }
+
+        /**
+        * Replaces the pattern with the cells of a board
+        * Board cell (row, col) becomes plane cell (x = col, y = row)
+        * @param source is the board to read, "#" is alive and anything else is dead
+        */
+        void loadFromBoard(Board& source) {
+            generation = source.generation;
+
+            int level = 3;
+            while (((int64_t)1 << (level - 1)) < std::max(source.getBoardSizeX(), source.getBoardSizeY())) {
+                level++;
+            }
+
+            // The board goes in the south east quarter so its corner sits on the origin
+            Node* e = emptyNode(level - 1);
+            root = join(e, e, e, buildFromBoard(source, level - 1, 0, 0));
+
+            collectGarbage();
+        }
+
+        /**
+        * Replaces the pattern with an RLE file, the top left corner of the pattern goes on the origin
+        * The runs are collected into 8x8 leaves as they're decoded and the tree is built up from those,
+        * so patterns far bigger than any Board load in memory proportional to their live area
+        * @param filename is the file to read, it has to be a B3/S23 pattern
+        * @return false if it can't be read, the pattern is left alone then
+        */
+        bool loadRLE(const std::string& filename) {
+            RLEReader reader;
+            if (!reader.open(filename)) {
+                return false;
+            }
+            Rule rule;
+            if (!parsePatternRule(reader.rule, rule) || rule != Rule()) {
+                std::cerr << "HashLife only runs B3/S23, \"" << filename << "\" is " << reader.rule << ".\n";
+                return false;
+            }
+
+            // Leaves by position, x in the low half of the key and y in the high half
+            std::unordered_map<uint64_t, uint64_t> leaves;
+            bool read = reader.read([&](int64_t row, int64_t col, int64_t count)
+            {
+                for (int64_t x = col; x < col + count; x++)
+                {
+                    leaves[(uint64_t)(row >> 3) << 32 | (uint64_t)(x >> 3)] |= 1ull << ((row & 7) * 8 + (x & 7));
+                }
+            });
+            if (!read) {
+                return false;
+            }
+
+            int64_t size = std::max<int64_t>({ reader.width, reader.height, (int64_t)8 });
+            for (auto& leaf : leaves)
+            {
+                size = std::max<int64_t>(size, 8 * ((int64_t)std::max(leaf.first >> 32, leaf.first & 0xFFFFFFFF) + 1));
+            }
+            int level = 3;
+            while (((int64_t)1 << level) < size) {
+                level++;
+            }
+
+            // Join squares four at a time until one covers the whole pattern
+            std::unordered_map<uint64_t, Node*> squares;
+            for (auto& leaf : leaves)
+            {
+                squares[leaf.first] = leafNode(leaf.second);
+            }
+            for (int l = 3; l < level; l++)
+            {
+                std::unordered_map<uint64_t, Node*> parents;
+                for (auto& square : squares)
+                {
+                    uint64_t x = square.first & 0xFFFFFFFF;
+                    uint64_t y = square.first >> 32;
+                    Node*& parent = parents[(y >> 1) << 32 | (x >> 1)];
+                    if (!parent) {
+                        Node* e = emptyNode(l);
+                        parent = join(e, e, e, e);
+                    }
+                    Node* children[4] = { parent->nw, parent->ne, parent->sw, parent->se };
+                    children[(y & 1) * 2 + (x & 1)] = square.second;
+                    parent = join(children[0], children[1], children[2], children[3]);
+                }
+                squares.swap(parents);
+            }
+
+            // The pattern goes in the south east quarter so its corner sits on the origin like loadFromBoard
+            Node* e = emptyNode(level);
+            root = join(e, e, e, squares.empty() ? e : squares.begin()->second);
+            generation = 0;
+
+            collectGarbage();
+            return true;
+        }
+
+        /**
+        * Replaces the pattern with a macrocell file, the quadtree format other HashLife programs save
+        * Nodes are read one line at a time and joined as they come, so the file is never held in memory
+        * @param filename is the file to read, it has to be a B3/S23 pattern
+        * @return false if it can't be read, the pattern is left alone then
+        */
+        bool loadMacrocell(const std::string& filename) {
+            std::ifstream infile(filename);
+            std::string line;
+            if (!infile || !std::getline(infile, line) || line.compare(0, 4, "[M2]") != 0) {
+                std::cerr << "\"" << filename << "\" isn't a macrocell file.\n";
+                return false;
+            }
+
+            std::vector<Node*> nodes(1, nullptr); // numbered from 1, 0 is an empty child
+            uint64_t fileGeneration = 0;
+            while (std::getline(infile, line)) {
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (line.empty()) {
+                    continue;
+                }
+
+                if (line[0] == '#') {
+                    if (line.compare(0, 3, "#R ") == 0) {
+                        Rule rule;
+                        if (!parsePatternRule(line.substr(3), rule) || rule != Rule()) {
+                            std::cerr << "HashLife only runs B3/S23, \"" << filename << "\" is " << line.substr(3) << ".\n";
+                            return false;
+                        }
+                    }
+                    else if (line.compare(0, 3, "#G ") == 0) {
+                        fileGeneration = std::strtoull(line.c_str() + 3, nullptr, 10);
+                    }
+                    continue;
+                }
+
+                if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+                    // An 8x8 leaf, "$" ends a row
+                    uint64_t bits = 0;
+                    int x = 0;
+                    int y = 0;
+                    for (char c : line)
+                    {
+                        if (c == '$') {
+                            x = 0;
+                            y++;
+                        }
+                        else if (x < 8 && y < 8) {
+                            bits |= (uint64_t)(c == '*') << (8 * y + x);
+                            x++;
+                        }
+                    }
+                    nodes.push_back(leafNode(bits));
+                    continue;
+                }
+
+                // "level nw ne sw se"
+                char* pos = &line[0];
+                long level = std::strtol(pos, &pos, 10);
+                Node* children[4];
+                bool valid = level > 3 && level < 63;
+                for (int i = 0; i < 4 && valid; i++)
+                {
+                    uint64_t number = std::strtoull(pos, &pos, 10);
+                    valid = number < nodes.size() && (number == 0 || nodes[number]->level == level - 1);
+                    children[i] = valid ? (number ? nodes[number] : emptyNode(level - 1)) : nullptr;
+                }
+                if (!valid) {
+                    std::cerr << "Bad node \"" << line << "\" in \"" << filename << "\".\n";
+                    return false;
+                }
+                nodes.push_back(join(children[0], children[1], children[2], children[3]));
+            }
+
+            if (nodes.size() < 2) {
+                std::cerr << "\"" << filename << "\" has no nodes.\n";
+                return false;
+            }
+
+            // The last node is the root, its centre is the origin
+            root = nodes.back();
+            generation = fileGeneration;
+
+            collectGarbage();
+            return true;
+        }
+
+        /**
+        * Saves the pattern as a macrocell file, every distinct square is written once
+        * @param filename is the file to write
+        * @return false if it couldn't be written, the error is printed
+        */
+        bool saveMacrocell(const std::string& filename) {
+            std::ofstream outfile(filename);
+            outfile << "[M2] (GameOfLifeCPP)\n";
+            outfile << "#R B3/S23\n";
+            outfile << "#G " << generation << '\n';
+
+            // Stepping can leave a smaller root than a leaf, growing it keeps the cells where they are
+            while (root->level < 3) {
+                root = expand(root);
+            }
+
+            std::unordered_map<Node*, uint64_t> numbers;
+            writeMacrocellNode(outfile, root, numbers);
+            if (root->population == 0) {
+                // Nothing to number, an empty leaf still gives the file a root
+                outfile << "$\n";
+            }
+
+            if (!outfile) {
+                std::cerr << "Couldn't write \"" << filename << "\".\n";
+                return false;
+            }
+            return true;
+        }
+
+        /**
+        * Writes the part of the plane that overlaps a board into it, everything else on the board is cleared
+        * @param target is the board to write
+        */
+        void storeToBoard(Board& target) {
+            target.clearBoard();
+            target.generation = generation;
+            storeNode(target, root, rootOrigin(), rootOrigin());
+        }
+
+        // Returns 1 if the cell at (x, y) is alive
+        int getCell(int64_t x, int64_t y) {
+            Node* n = root;
+            int64_t half = (int64_t)1 << (n->level - 1);
+            if (x < -half || x >= half || y < -half || y >= half) {
+                return 0;
+            }
+            x += half;
+            y += half;
+            while (n->level > 0 && n->population > 0) {
+                half = (int64_t)1 << (n->level - 1);
+                if (y < half) {
+                    n = x < half ? n->nw : n->ne;
+                }
+                else {
+                    n = x < half ? n->sw : n->se;
+                }
+                x &= half - 1;
+                y &= half - 1;
+            }
+            return (int)n->population;
+        }
+
+        uint64_t population() {
+            return root->population;
+        }
+};
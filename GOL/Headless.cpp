@@ -0,0 +1,349 @@
+// Headless.cpp : Runs the simulation without a window, for batch jobs and machines without a display.
+//
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <climits>
+#include <tbb/global_control.h>
+#include <tbb/info.h>
+
+#include "Board.h"
+#include "Config.h"
+#include "Recording.h"
+#include "Slab.h"
+
+// Game of Life CPP, headless runner
+//
+// Reads the same config.txt as the window, the command line overrides it.
+// Prints how fast the generations ran when it's done.
+// With --workers the board is split into slabs of rows, each stepped by its own process.
+
+static void printUsage() {
+    std::cout <<
+        "Usage: Headless [options]\n"
+        "  --config FILE        settings to start from (config.txt)\n"
+        "  --input FILE         starting board, an .rle pattern, a .gol snapshot or a text board\n"
+        "                       of \"#\" and \".\", without it the config picks the board\n"
+        "  --size WxH           board size, a snapshot has to match it\n"
+        "  --rule RULE          rule in B/S notation like B36/S23\n"
+        "  --wrap               cells on one edge are neighbors of the opposite edge\n"
+        "  --generations N      generations to run (100)\n"
+        "  --threads N          worker threads (all cores)\n"
+        "  --output FILE        writes the last generation, .rle, .gol or a text board\n"
+        "  --record FILE        records the run for replaying in the window\n"
+        "  --record-every N     records every Nth generation (1)\n"
+        "  --workers N          splits the board across N processes, the threads are shared between them,\n"
+        "                       can't be used with --output or --record\n"
+        "  --help               shows this\n";
+}
+
+static bool endsWith(const std::string& text, const std::string& end) {
+    return text.size() >= end.size() && text.compare(text.size() - end.size(), end.size(), end) == 0;
+}
+
+// Writes the board as rows of "#" and ".", the format loadFromFile reads
+static bool saveText(Board& board, const std::string& filename) {
+    std::ofstream outfile(filename, std::ios::binary);
+    for (int row = 0; row < board.getBoardSizeY(); row++)
+    {
+        outfile.write(board.getRow(row), board.getBoardSizeX());
+        outfile.put('\n');
+    }
+    if (!outfile) {
+        std::cerr << "Couldn't write \"" << filename << "\".\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+* Fills the starting board from the input file, or from the config without one
+* @param rule is the rule asked for on the command line, it replaces an RLE file's rule
+* @return false if the input couldn't be read, the error is printed
+*/
+static bool loadStart(Board& board, const Config& config, const std::string& inputFile, const std::string& rule) {
+    if (inputFile.empty()) {
+        config.seedBoard(board, soupNoise());
+        return true;
+    }
+    if (endsWith(inputFile, ".rle")) {
+        if (!board.loadFromRLE(inputFile)) {
+            return false;
+        }
+        if (!rule.empty()) {
+            board.setRule(rule); // the file's rule unless one was asked for
+        }
+        return true;
+    }
+    if (endsWith(inputFile, ".gol")) {
+        return board.loadSnapshot(inputFile);
+    }
+    return board.loadFromFile(inputFile);
+}
+
+#ifndef _WIN32
+/**
+* Runs the board as slabs in worker processes, the workers are forked before this process starts any threads
+* @return the exit code
+*/
+static int runWorkers(const Config& config, const std::string& inputFile, const std::string& rule, uint64_t generations, int threads, int workers) {
+    uint16_t sizeX = config.BOARDSIZE_X;
+    uint16_t sizeY = config.BOARDSIZE_Y;
+    Board::EdgeMode edgeMode = config.WRAP_EDGES ? Board::EdgeMode::Wrap : Board::EdgeMode::Dead;
+
+    SocketTransport transport;
+    bool launched = SocketTransport::launch(workers, [=](Transport& link) -> int
+    {
+        // Each worker gets its share of the threads
+        int share = std::max(1, (threads > 0 ? threads : tbb::info::default_concurrency()) / workers);
+        tbb::global_control threadLimit(tbb::global_control::max_allowed_parallelism, share);
+
+        SlabWorker worker(link, sizeX, sizeY, edgeMode);
+        worker.getBoard().setAgeTracking(false); // nothing draws the ages
+        if (!worker.receiveStart()) {
+            return 1;
+        }
+        return worker.serve() ? 0 : 1;
+    }, transport);
+    if (!launched) {
+        return 1;
+    }
+
+    SlabCoordinator coordinator(transport);
+    std::unique_ptr<tbb::global_control> threadLimit;
+    if (threads > 0) {
+        threadLimit.reset(new tbb::global_control(tbb::global_control::max_allowed_parallelism, threads));
+    }
+    Board board(sizeX, sizeY);
+    config.configureBoard(board);
+    if (!loadStart(board, config, inputFile, rule) || !coordinator.sendStart(board)) {
+        coordinator.stop();
+        transport.wait();
+        return 1;
+    }
+
+    std::cout << "Running " << generations << " generations of a " << sizeX << "x" << sizeY << " " << board.getRule().toString()
+        << " board on " << workers << " worker processes\n";
+
+    // Get Start Time
+    auto start = std::chrono::steady_clock::now();
+
+    SlabReport total = { board.generation, board.population(), SlabWorker::checksum(board) };
+    bool ok = generations == 0 || coordinator.run(generations, total);
+
+    // Get End Time
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    coordinator.stop();
+    ok = transport.wait() && ok;
+    if (!ok) {
+        std::cerr << "A worker process failed.\n";
+        return 1;
+    }
+
+    double cells = (double)sizeX * sizeY * generations;
+    std::cout << "Generation " << total.generation << ", population " << total.population << ", checksum " << total.checksum << '\n';
+    std::cout << "Took " << seconds << " seconds, " << (seconds > 0 ? generations / seconds : 0) << " generations/second, "
+        << (seconds > 0 ? cells / seconds : 0) << " cells/second\n";
+    return 0;
+}
+#endif
+
+/* MAIN */
+int main(int argc, char* argv[])
+{
+    std::string configFile = "config.txt";
+    std::string inputFile;
+    std::string outputFile;
+    std::string recordFile;
+    std::string rule;
+    int sizeX = 0;
+    int sizeY = 0;
+    bool wrap = false;
+    uint64_t generations = 100;
+    int threads = 0;
+    int workers = 0;
+    uint32_t recordEvery = 1;
+
+    // Read the command line, every option but --wrap and --help takes a value
+    for (int i = 1; i < argc; i++)
+    {
+        std::string option = argv[i];
+        if (option == "--help") {
+            printUsage();
+            return 0;
+        }
+        if (option == "--wrap") {
+            wrap = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing a value after " << option << ".\n";
+            printUsage();
+            return 1;
+        }
+
+        std::string value = argv[++i];
+        try {
+            if (option == "--config") {
+                configFile = value;
+            }
+            else if (option == "--input") {
+                inputFile = value;
+            }
+            else if (option == "--output") {
+                outputFile = value;
+            }
+            else if (option == "--record") {
+                recordFile = value;
+            }
+            else if (option == "--rule") {
+                rule = value;
+            }
+            else if (option == "--size") {
+                size_t x = value.find('x');
+                sizeX = std::stoi(value.substr(0, x));
+                sizeY = x == std::string::npos ? sizeX : std::stoi(value.substr(x + 1));
+            }
+            else if (option == "--generations") {
+                generations = std::stoull(value);
+            }
+            else if (option == "--threads") {
+                threads = std::stoi(value);
+            }
+            else if (option == "--workers") {
+                workers = std::stoi(value);
+            }
+            else if (option == "--record-every") {
+                recordEvery = (uint32_t)std::max(1, std::stoi(value));
+            }
+            else {
+                std::cerr << "Unknown option " << option << ".\n";
+                printUsage();
+                return 1;
+            }
+        }
+        catch (const std::exception&) {
+            std::cerr << "Bad value \"" << value << "\" for " << option << ".\n";
+            return 1;
+        }
+    }
+
+    if (sizeX < 0 || sizeY < 0 || sizeX > 65535 || sizeY > 65535 || (sizeX == 0) != (sizeY == 0) || threads < 0 || workers < 0) {
+        std::cerr << "The size has to be 1 to 65535 and the thread and worker counts can't be negative.\n";
+        return 1;
+    }
+    if (workers > 0 && (!outputFile.empty() || !recordFile.empty())) {
+        std::cerr << "--output and --record need the whole board in one process, they can't be used with --workers.\n";
+        return 1;
+    }
+
+    // The command line wins over the config, a missing config just means the defaults
+    Config config;
+    if (configFile != "config.txt" || std::ifstream(configFile)) {
+        config.load(configFile);
+    }
+    if (sizeX > 0) {
+        config.BOARDSIZE_X = sizeX;
+        config.BOARDSIZE_Y = sizeY;
+    }
+    if (!rule.empty()) {
+        config.RULE = rule;
+    }
+    config.WRAP_EDGES = config.WRAP_EDGES || wrap;
+
+    if (workers > 0) {
+#ifdef _WIN32
+        std::cerr << "--workers needs fork, it isn't available on Windows.\n";
+        return 1;
+#else
+        if (workers > config.BOARDSIZE_Y) {
+            std::cerr << "There can't be more workers than rows.\n";
+            return 1;
+        }
+        if (!SlabWorker::slabsFit(config.BOARDSIZE_Y, workers)) {
+            std::cerr << "Each worker can hold " << (int)SlabWorker::MAX_SLAB_ROWS << " rows, " << config.BOARDSIZE_Y << " rows need at least "
+                << (config.BOARDSIZE_Y + SlabWorker::MAX_SLAB_ROWS - 1) / SlabWorker::MAX_SLAB_ROWS << " workers.\n";
+            return 1;
+        }
+        return runWorkers(config, inputFile, rule, generations, threads, workers);
+#endif
+    }
+
+    std::unique_ptr<tbb::global_control> threadLimit;
+    if (threads > 0) {
+        threadLimit.reset(new tbb::global_control(tbb::global_control::max_allowed_parallelism, threads));
+    }
+
+    Board board(config.BOARDSIZE_X, config.BOARDSIZE_Y);
+    config.configureBoard(board);
+    board.setAgeTracking(false); // nothing draws the ages
+
+    if (!loadStart(board, config, inputFile, rule)) {
+        return 1;
+    }
+
+    Recorder recorder;
+    if (!recordFile.empty()) {
+        if (!recorder.open(recordFile, board, recordEvery)) {
+            return 1;
+        }
+        recorder.record(board);
+    }
+
+    std::cout << "Running " << generations << " generations of a " << board.getBoardSizeX() << "x" << board.getBoardSizeY()
+        << " " << board.getRule().toString() << " board on " << tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism)
+        << " threads\n";
+
+    // Get Start Time
+    auto start = std::chrono::steady_clock::now();
+
+    // Several generations per pass over the board, a recording cuts the passes at the generations it keeps
+    uint64_t remaining = generations;
+    while (remaining > 0) {
+        uint64_t count = recorder.isOpen() ? recordEvery - board.generation % recordEvery : remaining;
+        count = std::min<uint64_t>({ count, remaining, (uint64_t)INT_MAX });
+        board.nextGenerations((int)count);
+        recorder.record(board);
+        remaining -= count;
+    }
+
+    // Get End Time
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    if (!recorder.close()) {
+        return 1;
+    }
+
+    double cells = (double)board.getBoardSizeX() * board.getBoardSizeY() * generations;
+    std::cout << "Generation " << board.generation << ", population " << board.population() << ", checksum " << SlabWorker::checksum(board) << '\n';
+    std::cout << "Took " << seconds << " seconds, " << (seconds > 0 ? generations / seconds : 0) << " generations/second, "
+        << (seconds > 0 ? cells / seconds : 0) << " cells/second\n";
+    if (board.isPeriodic()) {
+        // Only the ends of the passes are hashed, so this can be a multiple of the real period
+        std::cout << "Repeats every " << board.getPeriod() << " generations since generation " << board.getCycleStart() << '\n';
+    }
+
+    if (!outputFile.empty()) {
+        bool saved;
+        if (endsWith(outputFile, ".rle")) {
+            saved = board.saveToRLE(outputFile);
+        }
+        else if (endsWith(outputFile, ".gol")) {
+            saved = board.saveSnapshot(outputFile);
+        }
+        else {
+            saved = saveText(board, outputFile);
+        }
+        if (!saved) {
+            return 1;
+        }
+    }
+    return 0;
+}
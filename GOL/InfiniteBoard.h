@@ -0,0 +1,320 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "Board.h"
+#include "PackedBoard.h"
+
+// Unbounded board
+//
+// The plane is cut into 64x64 chunks and only chunks with live cells are stored,
+// in a hash map keyed by their chunk coordinates. Chunks are created when something
+// grows into them and freed as soon as they are empty, so memory and work follow
+// the live cells instead of the bounding box.
+// Chunk coordinates are 32 bit, so the plane ends 2^37 cells from the origin in every
+// direction. Cells past that can't be set and patterns growing into it see dead cells.
+
+class InfiniteBoard
+{
+    private:
+
+        enum { CHUNK_SIZE = 64 };
+
+        struct Chunk
+        {
+            uint64_t rows[64] = {}; // bit j of rows[r] is cell (x + j, y + r) of the chunk
+        };
+
+        typedef std::unordered_map<uint64_t, Chunk> Chunks;
+
+        Chunks chunks;
+
+        static bool inPlane(int64_t chunkX, int64_t chunkY) {
+            return chunkX >= INT32_MIN && chunkX <= INT32_MAX && chunkY >= INT32_MIN && chunkY <= INT32_MAX;
+        }
+
+        // Packs signed chunk coordinates into a map key, they have to be inPlane
+        static uint64_t chunkKey(int64_t chunkX, int64_t chunkY) {
+            return ((uint64_t)(uint32_t)chunkY << 32) | (uint32_t)chunkX;
+        }
+
+        static int64_t keyX(uint64_t key) {
+            return (int32_t)(uint32_t)key;
+        }
+
+        static int64_t keyY(uint64_t key) {
+            return (int32_t)(uint32_t)(key >> 32);
+        }
+
+        // Chunk containing a cell, rounding towards negative infinity
+        static int64_t chunkOf(int64_t cell) {
+            return cell >= 0 ? cell / CHUNK_SIZE : (cell - (CHUNK_SIZE - 1)) / CHUNK_SIZE;
+        }
+
+        const Chunk* findChunk(int64_t chunkX, int64_t chunkY) const {
+            if (!inPlane(chunkX, chunkY)) {
+                return nullptr;
+            }
+            auto it = chunks.find(chunkKey(chunkX, chunkY));
+            return it == chunks.end() ? nullptr : &it->second;
+        }
+
+        static bool isEmpty(const Chunk& chunk) {
+            for (uint64_t row : chunk.rows)
+            {
+                if (row) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+        * Computes the next generation of one chunk from the chunk and its eight neighbors
+        * @return true if the new chunk has live cells
+        */
+        bool stepChunk(uint64_t key, Chunk& out) const {
+            static const Chunk empty;
+
+            int64_t cx = keyX(key);
+            int64_t cy = keyY(key);
+            const Chunk* around[3][3];
+            for (int i = 0; i < 3; i++)
+            {
+                for (int j = 0; j < 3; j++)
+                {
+                    const Chunk* c = findChunk(cx + j - 1, cy + i - 1);
+                    around[i][j] = c ? c : &empty;
+                }
+            }
+
+            // Rows -1 to 64 of the chunk with the words to their left and right
+            uint64_t west[66], middle[66], east[66];
+            for (int r = -1; r <= CHUNK_SIZE; r++)
+            {
+                int band = r < 0 ? 0 : (r < CHUNK_SIZE ? 1 : 2);
+                int rr = (r + CHUNK_SIZE) % CHUNK_SIZE;
+                west[r + 1] = around[band][0]->rows[rr];
+                middle[r + 1] = around[band][1]->rows[rr];
+                east[r + 1] = around[band][2]->rows[rr];
+            }
+
+            uint64_t any = 0;
+            for (int r = 0; r < CHUNK_SIZE; r++)
+            {
+                int a = r; // row above
+                int m = r + 1;
+                int b = r + 2; // row below
+                uint64_t next = lifeWord(
+                    (middle[a] << 1) | (west[a] >> 63), middle[a], (middle[a] >> 1) | (east[a] << 63),
+                    (middle[m] << 1) | (west[m] >> 63), middle[m], (middle[m] >> 1) | (east[m] << 63),
+                    (middle[b] << 1) | (west[b] >> 63), middle[b], (middle[b] >> 1) | (east[b] << 63));
+                out.rows[r] = next;
+                any |= next;
+            }
+            return any != 0;
+        }
+
+    public:
+
+        uint64_t generation = 0;
+
+        /**
+        * Computes the next generation
+        * Only stored chunks and the neighbors their edge cells can grow into are computed
+        */
+        void nextGeneration() {
+
+            generation++; // increment the generation
+
+            // Gather every chunk that can hold live cells next generation
+            std::vector<uint64_t> candidates;
+            candidates.reserve(chunks.size() * 2);
+
+            // Nothing grows past the edge of the plane
+            auto addCandidate = [&](int64_t x, int64_t y)
+            {
+                if (inPlane(x, y)) {
+                    candidates.push_back(chunkKey(x, y));
+                }
+            };
+
+            for (const auto& entry : chunks)
+            {
+                const Chunk& c = entry.second;
+                int64_t cx = keyX(entry.first);
+                int64_t cy = keyY(entry.first);
+
+                uint64_t columns = 0;
+                for (uint64_t row : c.rows)
+                {
+                    columns |= row;
+                }
+                bool north = c.rows[0] != 0;
+                bool south = c.rows[CHUNK_SIZE - 1] != 0;
+                bool west = (columns & 1) != 0;
+                bool east = (columns >> 63) != 0;
+
+                candidates.push_back(entry.first);
+                if (north) {
+                    addCandidate(cx, cy - 1);
+                }
+                if (south) {
+                    addCandidate(cx, cy + 1);
+                }
+                if (west) {
+                    addCandidate(cx - 1, cy);
+                }
+                if (east) {
+                    addCandidate(cx + 1, cy);
+                }
+                if (north && west && (c.rows[0] & 1)) {
+                    addCandidate(cx - 1, cy - 1);
+                }
+                if (north && east && (c.rows[0] >> 63)) {
+                    addCandidate(cx + 1, cy - 1);
+                }
+                if (south && west && (c.rows[CHUNK_SIZE - 1] & 1)) {
+                    addCandidate(cx - 1, cy + 1);
+                }
+                if (south && east && (c.rows[CHUNK_SIZE - 1] >> 63)) {
+                    addCandidate(cx + 1, cy + 1);
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+            // The old map is only read while the chunks are computed
+            std::vector<Chunk> results(candidates.size());
+            std::vector<char> alive(candidates.size());
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, candidates.size()), [&](tbb::blocked_range<size_t> ib)
+            {
+                for (size_t i = ib.begin(); i < ib.end(); ++i)
+                {
+                    alive[i] = stepChunk(candidates[i], results[i]);
+                }
+            });
+
+            // Empty chunks are dropped here
+            Chunks nextChunks;
+            nextChunks.reserve(candidates.size());
+            for (size_t i = 0; i < candidates.size(); i++)
+            {
+                if (alive[i]) {
+                    nextChunks.emplace(candidates[i], results[i]);
+                }
+            }
+            chunks.swap(nextChunks);
+        }
+
+        /**
+        * Copies the live cells of a board onto the plane, board cell (row, col) becomes (x = col, y = row)
+        * @param source is the board to read, "#" is alive and anything else is dead
+        */
+        void loadFromBoard(Board& source) {
+            clearBoard();
+            generation = source.generation;
+            for (int row = 0; row < source.getBoardSizeY(); row++)
+            {
+                for (int col = 0; col < source.getBoardSizeX(); col++)
+                {
+                    if (source.getCell(row, col) == '#') {
+                        setCell(col, row, '#');
+                    }
+                }
+            }
+        }
+
+        /**
+        * Writes the window of the plane starting at (originX, originY) into a board
+        * @param target is the board to write, cells outside the plane's live area are cleared
+        */
+        void storeToBoard(Board& target, int64_t originX = 0, int64_t originY = 0) {
+            target.clearBoard();
+            target.generation = generation;
+            for (const auto& entry : chunks)
+            {
+                int64_t x0 = keyX(entry.first) * CHUNK_SIZE - originX;
+                int64_t y0 = keyY(entry.first) * CHUNK_SIZE - originY;
+                if (x0 + CHUNK_SIZE <= 0 || y0 + CHUNK_SIZE <= 0 || x0 >= target.getBoardSizeX() || y0 >= target.getBoardSizeY()) {
+                    continue;
+                }
+                for (int r = 0; r < CHUNK_SIZE; r++)
+                {
+                    uint64_t row = entry.second.rows[r];
+                    for (int j = 0; row && j < CHUNK_SIZE; j++)
+                    {
+                        if ((row >> j) & 1) {
+                            target.setCell((int)(y0 + r), (int)(x0 + j), '#');
+                        }
+                    }
+                }
+            }
+        }
+
+        // Cells past the edge of the plane are dead
+        char getCell(int64_t x, int64_t y) const {
+            const Chunk* c = findChunk(chunkOf(x), chunkOf(y));
+            if (!c) {
+                return '.';
+            }
+            int64_t lx = x - chunkOf(x) * CHUNK_SIZE;
+            int64_t ly = y - chunkOf(y) * CHUNK_SIZE;
+            return (c->rows[ly] >> lx) & 1 ? '#' : '.';
+        }
+
+        /**
+        * Sets a cell, chunks are made and freed as needed
+        * @return false if the cell is past the edge of the plane, nothing is changed then
+        */
+        bool setCell(int64_t x, int64_t y, char state) {
+            int64_t cx = chunkOf(x);
+            int64_t cy = chunkOf(y);
+            if (!inPlane(cx, cy)) {
+                return false;
+            }
+            uint64_t bit = 1ull << (x - cx * CHUNK_SIZE);
+            int64_t ly = y - cy * CHUNK_SIZE;
+
+            if (state == '#') {
+                chunks[chunkKey(cx, cy)].rows[ly] |= bit;
+            }
+            else {
+                auto it = chunks.find(chunkKey(cx, cy));
+                if (it != chunks.end()) {
+                    it->second.rows[ly] &= ~bit;
+                    if (isEmpty(it->second)) {
+                        chunks.erase(it);
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Counts the live cells
+        uint64_t population() const {
+            uint64_t count = 0;
+            for (const auto& entry : chunks)
+            {
+                for (uint64_t row : entry.second.rows)
+                {
+                    for (; row; row &= row - 1) {
+                        count++;
+                    }
+                }
+            }
+            return count;
+        }
+
+        size_t chunkCount() const {
+            return chunks.size();
+        }
+
+        void clearBoard() {
+            chunks.clear();
+        }
+};
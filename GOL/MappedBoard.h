@@ -0,0 +1,292 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+#include "Board.h"
+#include "PackedBoard.h"
+#include "MappedFile.h"
+
+// Bit packed board that lives in a memory mapped file, for boards bigger than RAM
+//
+// The file holds a header and two generations laid out like PackedBoard. A generation is
+// computed one band of rows at a time, the band after the current one is prefetched while
+// the current one is stepped and the band before it is released, so about three bands
+// are in memory at once. A 1M x 1M board is 125 GB per generation on disk.
+//
+// The header records the generation and which half is current, so reopening
+// the same file picks up where it stopped.
+
+class MappedBoard
+{
+    private:
+
+        struct Header
+        {
+            char magic[8];
+            uint64_t sizeX;
+            uint64_t sizeY;
+            uint64_t generation;
+            uint64_t current; // which half of the file holds the current generation
+        };
+
+        enum { HEADER_BYTES = 1 << 16 }; // keeps the generations page aligned
+        enum { BAND_BYTES = 32 << 20 }; // default band size
+
+        MappedFile file;
+
+        uint64_t BOARDSIZE_Y = 0;
+        uint64_t BOARDSIZE_X = 0;
+        uint64_t ROW_WORDS = 0; // number of 64 bit words in a row
+        uint64_t LAST_WORD_MASK = ~0ull; // valid cells in the last word of a row
+        uint64_t BAND_ROWS = 1; // rows stepped between prefetches
+
+        Header* header = nullptr;
+
+        // First word of a row in one half of the file
+        uint64_t* rowWords(uint64_t half, uint64_t row) {
+            uint64_t* words = (uint64_t*)(file.getData() + HEADER_BYTES);
+            return words + (half * BOARDSIZE_Y + row) * ROW_WORDS;
+        }
+
+        // Byte offset of a row in the file
+        uint64_t rowOffset(uint64_t half, uint64_t row) {
+            return HEADER_BYTES + (half * BOARDSIZE_Y + row) * ROW_WORDS * 8;
+        }
+
+        // Prefetches or releases rows [begin, end) of one half, rows past the board are ignored
+        void prefetchRows(uint64_t half, uint64_t begin, uint64_t end) {
+            end = std::min(end, BOARDSIZE_Y);
+            if (begin < end) {
+                file.prefetch(rowOffset(half, begin), (end - begin) * ROW_WORDS * 8);
+            }
+        }
+
+        void releaseRows(uint64_t half, uint64_t begin, uint64_t end) {
+            end = std::min(end, BOARDSIZE_Y);
+            if (begin < end) {
+                file.release(rowOffset(half, begin), (end - begin) * ROW_WORDS * 8);
+            }
+        }
+
+    public:
+
+        MappedBoard() {
+        }
+
+        /**
+        * Opens a board file, or creates it if it doesn't exist yet
+        * @param path is the file to map, it needs room for two generations
+        * @param newBOARDSIZE_X and newBOARDSIZE_Y are the board size, an existing file must have the same size
+        * @return false if the file couldn't be mapped or holds a board of another size, the error is printed
+        */
+        bool open(const std::string& path, uint64_t newBOARDSIZE_X, uint64_t newBOARDSIZE_Y) {
+            close();
+            if (newBOARDSIZE_X == 0 || newBOARDSIZE_Y == 0) {
+                std::cerr << "A mapped board needs at least one row and column.\n";
+                return false;
+            }
+
+            BOARDSIZE_X = newBOARDSIZE_X;
+            BOARDSIZE_Y = newBOARDSIZE_Y;
+            ROW_WORDS = (BOARDSIZE_X + 63) / 64;
+            LAST_WORD_MASK = BOARDSIZE_X % 64 != 0 ? (1ull << (BOARDSIZE_X % 64)) - 1 : ~0ull;
+            BAND_ROWS = std::max<uint64_t>(1, BAND_BYTES / (ROW_WORDS * 8));
+
+            if (!file.open(path, HEADER_BYTES + 2 * BOARDSIZE_Y * ROW_WORDS * 8)) {
+                return false;
+            }
+            header = (Header*)file.getData();
+
+            // A new file is all zeros, which is an empty board
+            static const char MAGIC[8] = { 'G', 'O', 'L', 'M', 'A', 'P', '0', '1' };
+            Header empty = {};
+            if (memcmp(header, &empty, sizeof(Header)) == 0) {
+                memcpy(header->magic, MAGIC, sizeof(MAGIC));
+                header->sizeX = BOARDSIZE_X;
+                header->sizeY = BOARDSIZE_Y;
+            }
+            else if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->sizeX != BOARDSIZE_X || header->sizeY != BOARDSIZE_Y || header->current > 1) {
+                std::cerr << "\"" << path << "\" isn't a " << BOARDSIZE_X << "x" << BOARDSIZE_Y << " board file.\n";
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        // Unmaps the file, everything stepped so far stays in it
+        void close() {
+            file.close();
+            header = nullptr;
+        }
+
+        // Writes everything back to the file now instead of whenever the OS gets to it
+        void flush() {
+            file.flush();
+        }
+
+        bool isOpen() {
+            return file.isOpen();
+        }
+
+        /**
+        * Sets how many rows are stepped between prefetches, the default keeps a band around 32 MB
+        * @param rows is the band height, at least 1
+        */
+        void setBandRows(uint64_t rows) {
+            BAND_ROWS = std::max<uint64_t>(1, rows);
+        }
+
+        uint64_t getBandRows() {
+            return BAND_ROWS;
+        }
+
+        /**
+        * Computes the next generation one band at a time
+        * Cells outside the board are treated as dead
+        */
+        void nextGeneration() {
+            uint64_t current = header->current;
+            uint64_t next = 1 - current;
+
+            for (uint64_t bandBegin = 0; bandBegin < BOARDSIZE_Y; bandBegin += BAND_ROWS)
+            {
+                uint64_t bandEnd = std::min(bandBegin + BAND_ROWS, BOARDSIZE_Y);
+
+                // The OS reads the next band in while this one is stepped, that band also needs the row below it
+                prefetchRows(current, bandEnd, bandEnd + BAND_ROWS + 1);
+                prefetchRows(next, bandEnd, bandEnd + BAND_ROWS);
+
+                tbb::parallel_for(tbb::blocked_range<uint64_t>(bandBegin, bandEnd), [&](tbb::blocked_range<uint64_t> ib)
+                {
+                    for (uint64_t row = ib.begin(); row < ib.end(); ++row)
+                    {
+                        const uint64_t* above = row > 0 ? rowWords(current, row - 1) : nullptr;
+                        const uint64_t* below = row + 1 < BOARDSIZE_Y ? rowWords(current, row + 1) : nullptr;
+                        lifeRow(above, rowWords(current, row), below, rowWords(next, row), ROW_WORDS, LAST_WORD_MASK);
+                    }
+                });
+
+                // Nothing reads the band before this one again this generation
+                if (bandBegin >= BAND_ROWS) {
+                    releaseRows(current, bandBegin - BAND_ROWS, bandBegin - 1);
+                    releaseRows(next, bandBegin - BAND_ROWS, bandBegin);
+                }
+            }
+
+            header->current = next;
+            header->generation++; // increment the generation
+        }
+
+        /**
+        * Copies the cells of a char board into a window of this one
+        * @param source is the board to read, "#" is alive and anything else is dead
+        * @param originRow and originCol are where the top left cell of source goes
+        */
+        void loadFromBoard(Board& source, uint64_t originRow = 0, uint64_t originCol = 0) {
+            for (int row = 0; row < source.getBoardSizeY(); row++)
+            {
+                for (int col = 0; col < source.getBoardSizeX(); col++)
+                {
+                    setCell(originRow + row, originCol + col, source.getCell(row, col));
+                }
+            }
+        }
+
+        /**
+        * Writes a window of this board into a char board
+        * @param target is the board to write, cells past the edge of this board are written dead
+        * @param originRow and originCol are the cell that goes in the top left of target
+        */
+        void storeToBoard(Board& target, uint64_t originRow = 0, uint64_t originCol = 0) {
+            target.generation = header->generation;
+
+            for (int row = 0; row < target.getBoardSizeY(); row++)
+            {
+                for (int col = 0; col < target.getBoardSizeX(); col++)
+                {
+                    target.setCell(row, col, getCell(originRow + row, originCol + col));
+                }
+            }
+        }
+
+        // Counts the live cells, this reads the whole file
+        uint64_t population() {
+            uint64_t current = header->current;
+            uint64_t count = 0;
+            for (uint64_t bandBegin = 0; bandBegin < BOARDSIZE_Y; bandBegin += BAND_ROWS)
+            {
+                uint64_t bandEnd = std::min(bandBegin + BAND_ROWS, BOARDSIZE_Y);
+                prefetchRows(current, bandEnd, bandEnd + BAND_ROWS);
+
+                count += tbb::parallel_reduce(tbb::blocked_range<uint64_t>(bandBegin, bandEnd), (uint64_t)0,
+                    [&](tbb::blocked_range<uint64_t> ib, uint64_t sum)
+                    {
+                        for (uint64_t row = ib.begin(); row < ib.end(); ++row)
+                        {
+                            const uint64_t* words = rowWords(current, row);
+                            for (uint64_t k = 0; k < ROW_WORDS; k++)
+                            {
+                                for (uint64_t word = words[k]; word; word &= word - 1) {
+                                    sum++;
+                                }
+                            }
+                        }
+                        return sum;
+                    },
+                    [](uint64_t a, uint64_t b) { return a + b; });
+
+                releaseRows(current, bandBegin, bandEnd);
+            }
+            return count;
+        }
+
+        // Cells outside the board are dead
+        char getCell(uint64_t row, uint64_t col) {
+            if (row >= BOARDSIZE_Y || col >= BOARDSIZE_X) {
+                return '.';
+            }
+            return (rowWords(header->current, row)[col / 64] >> (col % 64)) & 1 ? '#' : '.';
+        }
+
+        void setCell(uint64_t row, uint64_t col, char state) {
+            if (row < BOARDSIZE_Y && col < BOARDSIZE_X) {
+                uint64_t& word = rowWords(header->current, row)[col / 64];
+                uint64_t bit = 1ull << (col % 64);
+                if (state == '#') {
+                    word |= bit;
+                }
+                else {
+                    word &= ~bit;
+                }
+            }
+        }
+
+        uint64_t getGeneration() {
+            return header->generation;
+        }
+
+        uint64_t getBoardSizeX() {
+            return BOARDSIZE_X;
+        }
+
+        uint64_t getBoardSizeY() {
+            return BOARDSIZE_Y;
+        }
+
+        // Clears the current generation, this writes the whole half of the file
+        void clearBoard() {
+            uint64_t current = header->current;
+            for (uint64_t bandBegin = 0; bandBegin < BOARDSIZE_Y; bandBegin += BAND_ROWS)
+            {
+                uint64_t bandEnd = std::min(bandBegin + BAND_ROWS, BOARDSIZE_Y);
+                memset(rowWords(current, bandBegin), 0, (bandEnd - bandBegin) * ROW_WORDS * 8);
+                releaseRows(current, bandBegin, bandEnd);
+            }
+        }
+};
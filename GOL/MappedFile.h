@@ -0,0 +1,251 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // Board.h and the rest use std::min and std::max
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A file mapped into memory for reading and writing
+//
+// The OS pages the file in and out as it's touched, so the file can be much bigger than RAM.
+// prefetch and release tell the OS which parts will be needed soon and which won't,
+// prefetching returns right away and the reads happen in the background.
+
+class MappedFile
+{
+    private:
+
+        uint8_t* data = nullptr;
+        uint64_t size = 0;
+
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = NULL;
+#else
+        int file = -1;
+#endif
+
+        /**
+        * Rounds a range to whole pages, madvise wants page aligned addresses
+        * @param outward is true to grow the range to the pages it touches, false to shrink it to the pages
+        * it covers completely so the pages next to it are left alone
+        */
+        void pageRange(uint64_t& offset, uint64_t& length, bool outward) {
+            static const uint64_t PAGE = 1 << 16; // a multiple of the page size everywhere we run
+            uint64_t end = std::min(offset + length, size);
+            if (outward) {
+                offset -= offset % PAGE;
+            }
+            else {
+                offset += (PAGE - offset % PAGE) % PAGE;
+                if (end != size) {
+                    end -= end % PAGE; // the last page of the file has nothing after it
+                }
+            }
+            length = end > offset ? end - offset : 0;
+        }
+
+    public:
+
+        MappedFile() {
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+            close();
+        }
+
+        /**
+        * Opens a file and maps all of it, the file is created or grown to newSize bytes if it's smaller
+        * @param path is the file to map
+        * @param newSize is the size of the mapping in bytes
+        * @return false if the file couldn't be opened or mapped, the error is printed
+        */
+        bool open(const std::string& path, uint64_t newSize) {
+            close();
+
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE) {
+                std::cerr << "Couldn't open \"" << path << "\" for mapping.\n";
+                return false;
+            }
+            mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)(newSize >> 32), (DWORD)newSize, NULL);
+            if (mapping == NULL) {
+                std::cerr << "Couldn't map \"" << path << "\".\n";
+                close();
+                return false;
+            }
+            data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)newSize);
+#else
+            file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (file < 0) {
+                std::cerr << "Couldn't open \"" << path << "\" for mapping.\n";
+                return false;
+            }
+            struct stat info;
+            if (fstat(file, &info) != 0 || ((uint64_t)info.st_size < newSize && ftruncate(file, (off_t)newSize) != 0)) {
+                std::cerr << "Couldn't resize \"" << path << "\" to " << newSize << " bytes.\n";
+                close();
+                return false;
+            }
+            void* mapped = mmap(nullptr, (size_t)newSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+            data = mapped == MAP_FAILED ? nullptr : (uint8_t*)mapped;
+#endif
+
+            if (!data) {
+                std::cerr << "Couldn't map \"" << path << "\".\n";
+                close();
+                return false;
+            }
+            size = newSize;
+            return true;
+        }
+
+        /**
+        * Maps all of an existing file for reading, writing through getData isn't allowed
+        * @param path is the file to map
+        * @return false if the file doesn't exist, is empty or couldn't be mapped, the error is printed
+        */
+        bool openReadOnly(const std::string& path) {
+            close();
+
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE) {
+                std::cerr << "Couldn't open \"" << path << "\" for mapping.\n";
+                return false;
+            }
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+                std::cerr << "\"" << path << "\" is empty.\n";
+                close();
+                return false;
+            }
+            uint64_t newSize = (uint64_t)fileSize.QuadPart;
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping != NULL) {
+                data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            }
+#else
+            file = ::open(path.c_str(), O_RDONLY);
+            if (file < 0) {
+                std::cerr << "Couldn't open \"" << path << "\" for mapping.\n";
+                return false;
+            }
+            struct stat info;
+            if (fstat(file, &info) != 0 || info.st_size == 0) {
+                std::cerr << "\"" << path << "\" is empty.\n";
+                close();
+                return false;
+            }
+            uint64_t newSize = (uint64_t)info.st_size;
+            void* mapped = mmap(nullptr, (size_t)newSize, PROT_READ, MAP_PRIVATE, file, 0);
+            data = mapped == MAP_FAILED ? nullptr : (uint8_t*)mapped;
+#endif
+
+            if (!data) {
+                std::cerr << "Couldn't map \"" << path << "\".\n";
+                close();
+                return false;
+            }
+            size = newSize;
+            return true;
+        }
+
+        // Unmaps the file, changes are written back by the OS
+        void close() {
+#ifdef _WIN32
+            if (data) {
+                UnmapViewOfFile(data);
+            }
+            if (mapping != NULL) {
+                CloseHandle(mapping);
+            }
+            if (file != INVALID_HANDLE_VALUE) {
+                CloseHandle(file);
+            }
+            mapping = NULL;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (data) {
+                munmap(data, (size_t)size);
+            }
+            if (file >= 0) {
+                ::close(file);
+            }
+            file = -1;
+#endif
+            data = nullptr;
+            size = 0;
+        }
+
+        // Asks the OS to start reading a range in the background
+        void prefetch(uint64_t offset, uint64_t length) {
+            pageRange(offset, length, true);
+            if (length == 0) {
+                return;
+            }
+#ifdef _WIN32
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = data + offset;
+            range.NumberOfBytes = (SIZE_T)length;
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+            madvise(data + offset, (size_t)length, MADV_WILLNEED);
+#endif
+        }
+
+        // Tells the OS a range won't be needed for a while, its memory can go to other pages
+        // Only pages entirely inside the range are dropped, rows next to it may still be in use
+        void release(uint64_t offset, uint64_t length) {
+            pageRange(offset, length, false);
+            if (length == 0) {
+                return;
+            }
+#ifdef _WIN32
+            // Pages leave the working set on their own, there's no cheap hint for a shared view
+#else
+            // The mapping is shared so changes stay in the file, only this process's pages are dropped
+            madvise(data + offset, (size_t)length, MADV_DONTNEED);
+#endif
+        }
+
+        // Writes changes back to the file
+        void flush() {
+            if (!data) {
+                return;
+            }
+#ifdef _WIN32
+            FlushViewOfFile(data, 0);
+            FlushFileBuffers(file);
+#else
+            msync(data, (size_t)size, MS_SYNC);
+#endif
+        }
+
+        bool isOpen() {
+            return data != nullptr;
+        }
+
+        uint8_t* getData() {
+            return data;
+        }
+
+        uint64_t getSize() {
+            return size;
+        }
+};
@@ -0,0 +1,231 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/cache_aligned_allocator.h>
+
+#include "Board.h"
+
+/**
+* Adds up the eight neighbors of 64 cells at once and applies the B3/S23 rule
+* Every argument holds one bit per cell, bit j of each word lines up with bit j of the others
+*
+* @param nw, n, ne are the neighbors in the row above
+* @param w, c, e are the neighbors to the left and right and the cells themselves
+* @param sw, s, se are the neighbors in the row below
+*/
+template <class Word>
+inline Word lifeWord(Word nw, Word n, Word ne, Word w, Word c, Word e, Word sw, Word s, Word se) {
+
+    // Full adders on the rows above and below, half adder on the middle row
+    Word aboveXor = nw ^ n;
+    Word above1 = aboveXor ^ ne;
+    Word above2 = (nw & n) | (aboveXor & ne);
+
+    Word belowXor = sw ^ s;
+    Word below1 = belowXor ^ se;
+    Word below2 = (sw & s) | (belowXor & se);
+
+    Word middle1 = w ^ e;
+    Word middle2 = w & e;
+
+    // Add the ones, which carries into the twos
+    Word onesXor = above1 ^ below1;
+    Word ones = onesXor ^ middle1;
+    Word onesCarry = (above1 & below1) | (onesXor & middle1);
+
+    // Add the four twos, anything that carries out of here means 4 or more neighbors
+    Word twosXor = above2 ^ below2;
+    Word twosPartial = twosXor ^ middle2;
+    Word fours1 = (above2 & below2) | (twosXor & middle2);
+    Word twos = twosPartial ^ onesCarry;
+    Word fours2 = twosPartial & onesCarry;
+
+    /*  GOL RULES BELOW  */
+
+    // Exactly 2 neighbors keeps a live cell, exactly 3 neighbors always gives a live cell
+    return twos & ~(fours1 | fours2) & (ones | c);
+}
+
+/**
+* Computes the next generation of one bit packed row
+* @param above and below are the rows next to it, nullptr for dead rows outside the board
+* @param middle is the row itself and out is where the next generation goes
+* @param rowWords is the number of words in a row and lastWordMask the valid cells in the last one
+*/
+inline void lifeRow(const uint64_t* above, const uint64_t* middle, const uint64_t* below, uint64_t* out, size_t rowWords, uint64_t lastWordMask) {
+    for (size_t k = 0; k < rowWords; k++)
+    {
+        uint64_t a[3] = { 0, 0, 0 }; // previous, current and next word of the row above
+        uint64_t m[3] = { 0, middle[k], 0 };
+        uint64_t b[3] = { 0, 0, 0 };
+
+        if (k > 0) {
+            m[0] = middle[k - 1];
+        }
+        if (k + 1 < rowWords) {
+            m[2] = middle[k + 1];
+        }
+        if (above) {
+            a[0] = k > 0 ? above[k - 1] : 0;
+            a[1] = above[k];
+            a[2] = k + 1 < rowWords ? above[k + 1] : 0;
+        }
+        if (below) {
+            b[0] = k > 0 ? below[k - 1] : 0;
+            b[1] = below[k];
+            b[2] = k + 1 < rowWords ? below[k + 1] : 0;
+        }
+
+        // Shift the neighbors into place, bits carry over from the adjacent words
+        uint64_t next = lifeWord(
+            (a[1] << 1) | (a[0] >> 63), a[1], (a[1] >> 1) | (a[2] << 63),
+            (m[1] << 1) | (m[0] >> 63), m[1], (m[1] >> 1) | (m[2] << 63),
+            (b[1] << 1) | (b[0] >> 63), b[1], (b[1] >> 1) | (b[2] << 63));
+
+        // Keep the padding past the right edge dead
+        if (k + 1 == rowWords) {
+            next &= lastWordMask;
+        }
+
+        out[k] = next;
+    }
+}
+
+class PackedBoard
+{
+    private:
+
+        typedef std::vector<uint64_t, tbb::cache_aligned_allocator<uint64_t>> Words;
+
+        uint16_t BOARDSIZE_Y = 20;
+        uint16_t BOARDSIZE_X = 20;
+        size_t ROW_WORDS = 1; // number of 64 bit words in a row
+        uint64_t LAST_WORD_MASK = ~0ull; // valid cells in the last word of a row
+
+        Words board; // 64 cells per word, bit j of word k is column 64 * k + j
+        Words boardNext; // the next generation is written here and then swapped in
+
+    public:
+
+        uint64_t generation = 0;
+
+        /* CONSTRUCTOR */
+        PackedBoard(uint16_t newBOARDSIZE_X, uint16_t newBOARDSIZE_Y) {
+            BOARDSIZE_X = newBOARDSIZE_X;
+            BOARDSIZE_Y = newBOARDSIZE_Y;
+
+            ROW_WORDS = (BOARDSIZE_X + 63) / 64;
+            if (BOARDSIZE_X % 64 != 0) {
+                LAST_WORD_MASK = (1ull << (BOARDSIZE_X % 64)) - 1;
+            }
+
+            board.assign(ROW_WORDS * BOARDSIZE_Y, 0);
+            boardNext.assign(ROW_WORDS * BOARDSIZE_Y, 0);
+        }
+
+        /**
+        * Computes the next generation 64 cells at a time
+        * Cells outside the board are treated as dead
+        */
+        void nextGeneration() {
+
+            generation++; // increment the generation
+
+            tbb::parallel_for(tbb::blocked_range<uint16_t>(0, BOARDSIZE_Y), [&](tbb::blocked_range<uint16_t> ib)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    const uint64_t* above = row > 0 ? &board[(row - 1) * ROW_WORDS] : nullptr;
+                    const uint64_t* below = row + 1 < BOARDSIZE_Y ? &board[(row + 1) * ROW_WORDS] : nullptr;
+                    lifeRow(above, &board[row * ROW_WORDS], below, &boardNext[row * ROW_WORDS], ROW_WORDS, LAST_WORD_MASK);
+                }
+            });
+
+            board.swap(boardNext);
+        }
+
+        /**
+        * Copies the cells of a char board into this one
+        * @param source is the board to read, "#" is alive and anything else is dead
+        */
+        void loadFromBoard(Board& source) {
+            generation = source.generation;
+            clearBoard();
+
+            int rows = std::min<int>(BOARDSIZE_Y, source.getBoardSizeY());
+            int cols = std::min<int>(BOARDSIZE_X, source.getBoardSizeX());
+            tbb::parallel_for(tbb::blocked_range<int>(0, rows), [&](tbb::blocked_range<int> ib)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    for (int col = 0; col < cols; ++col)
+                    {
+                        if (source.getCell(row, col) == '#') {
+                            board[row * ROW_WORDS + col / 64] |= 1ull << (col % 64);
+                        }
+                    }
+                }
+            });
+        }
+
+        /**
+        * Writes the cells of this board into a char board
+        * Ages are not tracked by the packed engine so they are left alone
+        * @param target is the board to write
+        */
+        void storeToBoard(Board& target) {
+            target.generation = generation;
+
+            int rows = std::min<int>(BOARDSIZE_Y, target.getBoardSizeY());
+            int cols = std::min<int>(BOARDSIZE_X, target.getBoardSizeX());
+            for (int row = 0; row < rows; row++)
+            {
+                for (int col = 0; col < cols; col++)
+                {
+                    target.setCell(row, col, getCell(row, col));
+                }
+            }
+        }
+
+        // Counts the live cells
+        size_t population() {
+            size_t count = 0;
+            for (uint64_t word : board) {
+                for (; word; word &= word - 1) {
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        char getCell(int row, int col) {
+            return (board[row * ROW_WORDS + col / 64] >> (col % 64)) & 1 ? '#' : '.';
+        }
+
+        void setCell(int row, int col, char state) {
+            if (row >= 0 && row < BOARDSIZE_Y && col >= 0 && col < BOARDSIZE_X) {
+                uint64_t bit = 1ull << (col % 64);
+                if (state == '#') {
+                    board[row * ROW_WORDS + col / 64] |= bit;
+                }
+                else {
+                    board[row * ROW_WORDS + col / 64] &= ~bit;
+                }
+            }
+        }
+
+        uint16_t getBoardSizeX() {
+            return BOARDSIZE_X;
+        }
+
+        uint16_t getBoardSizeY() {
+            return BOARDSIZE_Y;
+        }
+
+        void clearBoard() {
+            std::fill(board.begin(), board.end(), 0);
+        }
+};
@@ -0,0 +1,277 @@
+#pragma once
+#include <cstdint>
+#include <climits>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+
+#include "Rule.h"
+
+// Readers and writers for the RLE pattern format used by most pattern collections
+//
+// An RLE file has "#" comment lines, a header like "x = 3, y = 3, rule = B3/S23" and then
+// the cells as runs: "b" is a dead cell, "o" a live one, "$" ends a row and "!" ends the
+// pattern, each can have a count in front. The file is read in blocks and live runs are handed
+// to a callback as they're decoded, so a pattern never has to fit in memory as text.
+
+class RLEReader
+{
+    private:
+
+        enum { BLOCK_BYTES = 1 << 16 };
+
+        // Furthest row or column a run can reach, a run is at most INT32_MAX so adding one never overflows
+        static const int64_t MAX_POSITION = INT64_MAX / 2;
+
+        std::ifstream file;
+        std::vector<char> block;
+        size_t blockPos = 0;
+        size_t blockEnd = 0;
+
+        // Next byte of the file, -1 at the end
+        int next() {
+            if (blockPos == blockEnd) {
+                file.read(block.data(), block.size());
+                blockEnd = (size_t)file.gcount();
+                blockPos = 0;
+                if (blockEnd == 0) {
+                    return -1;
+                }
+            }
+            return (unsigned char)block[blockPos++];
+        }
+
+        // Reads the rest of a line, without the line break
+        bool readLine(std::string& line) {
+            line.clear();
+            int c = next();
+            if (c < 0) {
+                return false;
+            }
+            while (c >= 0 && c != '\n') {
+                if (c != '\r') {
+                    line += (char)c;
+                }
+                c = next();
+            }
+            return true;
+        }
+
+        // Parses "x = 3, y = 3, rule = B3/S23", keys other than these are ignored
+        bool parseHeader(const std::string& line) {
+            size_t pos = 0;
+            bool hasX = false;
+            bool hasY = false;
+            while (pos < line.size()) {
+                size_t comma = line.find(',', pos);
+                if (comma == std::string::npos) {
+                    comma = line.size();
+                }
+                std::string item = line.substr(pos, comma - pos);
+                pos = comma + 1;
+
+                size_t equals = item.find('=');
+                if (equals == std::string::npos) {
+                    continue;
+                }
+                std::string key;
+                std::string value;
+                for (size_t i = 0; i < item.size(); i++)
+                {
+                    if (!std::isspace((unsigned char)item[i])) {
+                        (i < equals ? key : value) += item[i];
+                    }
+                }
+                value.erase(0, value.size() && value[0] == '=' ? 1 : 0);
+
+                // 18 digits or fewer so stoll can't overflow
+                if (key == "x" && !value.empty() && value.size() <= 18 && value.find_first_not_of("0123456789") == std::string::npos) {
+                    width = std::stoll(value);
+                    hasX = true;
+                }
+                else if (key == "y" && !value.empty() && value.size() <= 18 && value.find_first_not_of("0123456789") == std::string::npos) {
+                    height = std::stoll(value);
+                    hasY = true;
+                }
+                else if (key == "rule") {
+                    rule = value;
+                }
+            }
+            return hasX && hasY;
+        }
+
+    public:
+
+        int64_t width = 0;
+        int64_t height = 0;
+        std::string rule; // as written in the file, empty if there was none
+
+        RLEReader() {
+            block.resize(BLOCK_BYTES);
+        }
+
+        /**
+        * Opens an RLE file and reads everything up to the first run
+        * @param filename is the file to read
+        * @return false if it can't be opened or has no header, the error is printed
+        */
+        bool open(const std::string& filename) {
+            file.open(filename, std::ios::binary);
+            if (!file) {
+                std::cerr << "Couldn't open pattern \"" << filename << "\".\n";
+                return false;
+            }
+
+            std::string line;
+            while (readLine(line)) {
+                if (line.empty() || line[0] == '#') {
+                    continue;
+                }
+                if (!parseHeader(line)) {
+                    break;
+                }
+                return true;
+            }
+            std::cerr << "\"" << filename << "\" has no RLE header.\n";
+            return false;
+        }
+
+        /**
+        * Decodes the runs, live runs are passed on as they're read and dead ones are skipped
+        * Letters other than "b" count as alive, so multi state patterns load as two states
+        * @param run is called with the row, the column and the length of every run of live cells
+        * @return false if the data has characters that aren't part of RLE or a run is too long
+        */
+        template <class F>
+        bool read(F&& run) {
+            int64_t row = 0;
+            int64_t col = 0;
+            int64_t count = 0;
+            int c;
+            while ((c = next()) >= 0) {
+                if (c >= '0' && c <= '9') {
+                    count = count * 10 + (c - '0');
+                    if (count > INT32_MAX) {
+                        std::cerr << "RLE run too long.\n";
+                        return false;
+                    }
+                    continue;
+                }
+                int64_t n = count ? count : 1;
+                count = 0;
+
+                if (c == 'b' || c == '.') {
+                    col += n;
+                }
+                else if (c == '$') {
+                    row += n;
+                    col = 0;
+                }
+                else if (c == '!') {
+                    return true;
+                }
+                else if (std::isalpha(c)) {
+                    run(row, col, n);
+                    col += n;
+                }
+                else if (c == '#') {
+                    // comment lines can come after the header too
+                    while (c >= 0 && c != '\n') {
+                        c = next();
+                    }
+                }
+                else if (!std::isspace(c)) {
+                    std::cerr << "Unexpected '" << (char)c << "' in RLE data.\n";
+                    return false;
+                }
+                if (row > MAX_POSITION || col > MAX_POSITION) {
+                    std::cerr << "RLE pattern too big.\n";
+                    return false;
+                }
+            }
+            return true; // the "!" is missing, what's there is still a pattern
+        }
+};
+
+/**
+* Reads the rule of a pattern file, B/S notation or the older S/B notation like "23/3"
+* @param text is the rule as written in the file, empty means Life
+* @param rule is set to the rule if it's valid and left alone otherwise
+* @return false if the rule isn't one Rule can hold
+*/
+inline bool parsePatternRule(const std::string& text, Rule& rule) {
+    if (text.empty()) {
+        rule = Rule();
+        return true;
+    }
+    if (Rule::parse(text, rule)) {
+        return true;
+    }
+    size_t slash = text.find('/');
+    if (slash == std::string::npos || text.find_first_not_of("012345678/") != std::string::npos) {
+        return false;
+    }
+    return Rule::parse("B" + text.substr(slash + 1) + "/S" + text.substr(0, slash), rule);
+}
+
+// Writes RLE a run at a time, lines are kept under 70 characters like other programs write them
+class RLEWriter
+{
+    private:
+
+        enum { LINE_LENGTH = 70 };
+
+        std::ofstream file;
+        std::string line;
+
+        // Adds one item, starting a new line when it wouldn't fit
+        void put(const std::string& item) {
+            if (line.size() + item.size() > LINE_LENGTH) {
+                file << line << '\n';
+                line.clear();
+            }
+            line += item;
+        }
+
+    public:
+
+        /**
+        * Creates the file and writes the header
+        * @param filename is the file to write
+        * @param width and height are the pattern size
+        * @param rule is the rule in B/S notation
+        * @return false if the file can't be created, the error is printed
+        */
+        bool open(const std::string& filename, int64_t width, int64_t height, const std::string& rule) {
+            file.open(filename, std::ios::binary);
+            if (!file) {
+                std::cerr << "Couldn't write pattern \"" << filename << "\".\n";
+                return false;
+            }
+            file << "x = " << width << ", y = " << height << ", rule = " << rule << '\n';
+            return true;
+        }
+
+        /**
+        * Writes a run
+        * @param count is the length, runs of 0 are skipped
+        * @param tag is "b" for dead cells, "o" for live cells or "$" for row ends
+        */
+        void add(int64_t count, char tag) {
+            if (count <= 0) {
+                return;
+            }
+            put(count == 1 ? std::string(1, tag) : std::to_string(count) + tag);
+        }
+
+        // Ends the pattern and flushes the file, false if something couldn't be written
+        bool close() {
+            put("!");
+            file << line << '\n';
+            line.clear();
+            file.close();
+            return !file.fail();
+        }
+};
@@ -0,0 +1,449 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/concurrent_queue.h>
+
+#include "Board.h"
+#include "Codec.h"
+
+// Recordings of a run, one frame per recorded generation
+//
+// A recording is a header followed by frames. Every frame is the board packed by packCells,
+// one row after another with each row starting on a new byte, and coded by compressRuns.
+// Key frames hold the cells themselves, every other frame holds the XOR with the frame before it,
+// so only cells that changed are set and a mostly still board codes to almost nothing.
+// The first frame is a key frame and so is the first frame after every keyframeInterval generations,
+// a replay can start decoding at any of them. Numbers are little endian.
+
+struct RecordingHeader
+{
+    char magic[8]; // "GOLREC01"
+    uint32_t sizeX;
+    uint32_t sizeY;
+    uint16_t birth;
+    uint16_t survive;
+    uint8_t edgeMode;
+    uint8_t reserved[3];
+    uint32_t every; // every how many generations a frame is written
+    uint32_t keyframeInterval; // at most this many generations between key frames
+};
+static_assert(sizeof(RecordingHeader) == 32, "the recording header is written as it is in memory");
+
+// Comes before the coded cells of every frame
+struct FrameHeader
+{
+    enum Type : uint8_t { KEY = 0, DELTA = 1 };
+
+    uint64_t generation;
+    uint64_t size; // bytes of coded cells after this header
+    uint8_t type;
+    uint8_t reserved[7];
+};
+static_assert(sizeof(FrameHeader) == 24, "frame headers are written as they are in memory");
+
+class Recorder
+{
+    private:
+
+        // A frame on its way to the writer thread, still packed but not coded
+        struct PendingFrame
+        {
+            uint64_t generation = 0;
+            uint8_t type = FrameHeader::KEY;
+            bool last = false; // tells the writer to stop
+            std::vector<uint8_t> bits;
+        };
+
+        enum { QUEUE_FRAMES = 16 }; // frames that can wait for the disk before record waits too
+
+        std::ofstream file;
+        std::string filename;
+        std::thread writer;
+        tbb::concurrent_bounded_queue<PendingFrame> queue;
+        std::atomic<bool> failed{ false };
+
+        int BOARDSIZE_X = 0;
+        int BOARDSIZE_Y = 0;
+        size_t ROW_BYTES = 0;
+        uint32_t every = 1;
+        uint32_t keyframeInterval = 1024;
+        std::vector<uint8_t> previous; // packed cells of the last recorded frame
+        bool hasPrevious = false;
+        uint64_t lastKeyframe = 0; // generation of the last key frame
+        uint64_t lastGeneration = 0; // generation of the last frame
+        uint64_t frames = 0;
+
+        // Runs on the writer thread, codes frames and writes them until the last one
+        void writeFrames() {
+            std::vector<uint8_t> coded;
+            while (true) {
+                PendingFrame frame;
+                queue.pop(frame);
+                if (frame.last) {
+                    break;
+                }
+
+                coded.clear();
+                compressRuns(frame.bits.data(), frame.bits.size(), coded);
+
+                FrameHeader header = {};
+                header.generation = frame.generation;
+                header.size = coded.size();
+                header.type = frame.type;
+                file.write((const char*)&header, sizeof(header));
+                file.write((const char*)coded.data(), coded.size());
+                if (!file && !failed) {
+                    std::cerr << "Couldn't write to recording \"" << filename << "\".\n";
+                    failed = true;
+                }
+            }
+            file.flush();
+        }
+
+    public:
+
+        Recorder() {
+            queue.set_capacity(QUEUE_FRAMES);
+        }
+
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+        ~Recorder() {
+            close();
+        }
+
+        /**
+        * Creates a recording and starts the writer thread, nothing is recorded until record is called
+        * @param newFilename is the file to write, it's replaced if it exists
+        * @param board is the board that will be recorded, its size and rule go in the header
+        * @param newEvery records every Nth generation, 1 records all of them
+        * @param newKeyframeInterval is the most generations between key frames, seeking decodes at most this many
+        * @return false if the file can't be created, the error is printed
+        */
+        bool open(const std::string& newFilename, Board& board, uint32_t newEvery = 1, uint32_t newKeyframeInterval = 1024) {
+            close();
+
+            filename = newFilename;
+            file.open(filename, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                std::cerr << "Couldn't create recording \"" << filename << "\".\n";
+                return false;
+            }
+
+            BOARDSIZE_X = board.getBoardSizeX();
+            BOARDSIZE_Y = board.getBoardSizeY();
+            ROW_BYTES = (BOARDSIZE_X + 7) / 8;
+            every = std::max<uint32_t>(1, newEvery);
+            keyframeInterval = std::max<uint32_t>(every, newKeyframeInterval);
+            previous.assign(ROW_BYTES * BOARDSIZE_Y, 0);
+            hasPrevious = false;
+            frames = 0;
+            failed = false;
+
+            RecordingHeader header = {};
+            std::memcpy(header.magic, "GOLREC01", 8);
+            header.sizeX = BOARDSIZE_X;
+            header.sizeY = BOARDSIZE_Y;
+            header.birth = board.getRule().birth;
+            header.survive = board.getRule().survive;
+            header.edgeMode = (uint8_t)board.getEdgeMode();
+            header.every = every;
+            header.keyframeInterval = keyframeInterval;
+            file.write((const char*)&header, sizeof(header));
+
+            writer = std::thread([this]() { writeFrames(); });
+            return true;
+        }
+
+        /**
+        * Records the board if its generation is one of every N, call it after every step
+        * The cells are packed and XORed with the last frame here, coding and writing happen on the writer thread
+        * This only waits when the writer is a whole queue of frames behind
+        * @param board is the board to record, it has to be the same size as the one it was opened with
+        * @return false if the recording isn't open or writing failed
+        */
+        bool record(Board& board) {
+            if (!writer.joinable() || failed) {
+                return false;
+            }
+            // Frames are indexed by generation, a board that went back in time isn't recorded until it catches up
+            if (board.generation % every != 0 || (hasPrevious && board.generation <= lastGeneration)) {
+                return true;
+            }
+
+            PendingFrame frame;
+            frame.generation = board.generation;
+            bool key = !hasPrevious || board.generation - lastKeyframe >= keyframeInterval;
+            frame.type = key ? FrameHeader::KEY : FrameHeader::DELTA;
+            if (key) {
+                lastKeyframe = board.generation;
+            }
+            frame.bits.resize(previous.size());
+            tbb::parallel_for(tbb::blocked_range<int>(0, BOARDSIZE_Y), [&](tbb::blocked_range<int> ib)
+            {
+                for (int row = ib.begin(); row < ib.end(); ++row)
+                {
+                    uint8_t* bits = &frame.bits[ROW_BYTES * row];
+                    uint8_t* last = &previous[ROW_BYTES * row];
+                    packCells(board.getRow(row), BOARDSIZE_X, bits);
+                    for (size_t k = 0; k < ROW_BYTES; k++)
+                    {
+                        uint8_t cells = bits[k];
+                        bits[k] ^= key ? 0 : last[k];
+                        last[k] = cells;
+                    }
+                }
+            });
+
+            hasPrevious = true;
+            lastGeneration = board.generation;
+            frames++;
+            queue.push(std::move(frame));
+            return true;
+        }
+
+        /**
+        * Writes out every frame still queued and closes the file
+        * @return false if anything couldn't be written
+        */
+        bool close() {
+            if (writer.joinable()) {
+                PendingFrame last;
+                last.last = true;
+                queue.push(std::move(last));
+                writer.join();
+                file.close();
+            }
+            return !failed;
+        }
+
+        bool isOpen() {
+            return writer.joinable();
+        }
+
+        // Frames recorded since open, some may still be queued
+        uint64_t frameCount() {
+            return frames;
+        }
+};
+
+// Plays a recording back, any recorded generation can be shown without decoding the whole run
+//
+// Opening scans the frame headers once to build an index of where every frame starts.
+// Seeking decodes forward from the nearest key frame before the target, or from where
+// the last seek stopped when that's closer, and a generation between two frames is
+// reached by stepping the board from the frame before it.
+class Replay
+{
+    private:
+
+        struct FrameEntry
+        {
+            uint64_t generation;
+            uint64_t offset; // of the coded cells in the file
+            uint64_t size;
+            uint8_t type;
+        };
+
+        std::ifstream file;
+        RecordingHeader header = {};
+        std::vector<FrameEntry> frames; // in file order, generations go up
+        size_t ROW_BYTES = 0;
+
+        std::vector<uint8_t> cells; // packed cells of the decoded frame
+        std::vector<uint8_t> delta;
+        std::vector<uint8_t> coded;
+        int64_t decoded = -1; // frame cells holds, -1 for none
+
+        // Decodes one frame on top of cells
+        bool applyFrame(size_t frame) {
+            const FrameEntry& entry = frames[frame];
+            coded.resize((size_t)entry.size);
+            file.clear();
+            file.seekg((std::streamoff)entry.offset);
+            file.read((char*)coded.data(), coded.size());
+            if (!file || !decompressRuns(coded.data(), coded.size(), delta.data(), delta.size())) {
+                std::cerr << "Frame for generation " << entry.generation << " of the recording is damaged.\n";
+                decoded = -1;
+                return false;
+            }
+
+            if (entry.type == FrameHeader::KEY) {
+                cells.swap(delta);
+            }
+            else {
+                for (size_t k = 0; k < cells.size(); k++)
+                {
+                    cells[k] ^= delta[k];
+                }
+            }
+            decoded = (int64_t)frame;
+            return true;
+        }
+
+    public:
+
+        /**
+        * Opens a recording and indexes its frames, a frame cut off at the end is left out
+        * Nothing the size of the board is allocated until the header and first key frame look right
+        * @param filename is the recording to read
+        * @param sizeX is the width the recording has to be, 0 takes any width
+        * @param sizeY is the height the recording has to be, 0 takes any height
+        * @return false if it isn't a recording, is the wrong size or has no frames, the error is printed
+        */
+        bool open(const std::string& filename, uint32_t sizeX = 0, uint32_t sizeY = 0) {
+            frames.clear();
+            decoded = -1;
+            file.close();
+            file.clear();
+            file.open(filename, std::ios::binary | std::ios::ate);
+            if (!file) {
+                std::cerr << "Couldn't open recording \"" << filename << "\".\n";
+                return false;
+            }
+            uint64_t fileSize = (uint64_t)file.tellg();
+            file.seekg(0);
+
+            file.read((char*)&header, sizeof(header));
+            // Boards are at most 65535 on a side
+            if (!file || std::memcmp(header.magic, "GOLREC01", 8) != 0 || header.sizeX == 0 || header.sizeY == 0
+                || header.sizeX > 65535 || header.sizeY > 65535) {
+                std::cerr << "\"" << filename << "\" isn't a recording.\n";
+                return false;
+            }
+            if ((sizeX != 0 && header.sizeX != sizeX) || (sizeY != 0 && header.sizeY != sizeY)) {
+                std::cerr << "Recording \"" << filename << "\" is " << header.sizeX << "x" << header.sizeY
+                    << " but the board is " << sizeX << "x" << sizeY << ".\n";
+                return false;
+            }
+            size_t rowBytes = (header.sizeX + 7) / 8;
+
+            uint64_t offset = sizeof(header);
+            FrameHeader frame;
+            while (offset + sizeof(frame) <= fileSize && file.read((char*)&frame, sizeof(frame))) {
+                offset += sizeof(frame);
+                if (frame.size > fileSize - offset || (frame.type != FrameHeader::KEY && frame.type != FrameHeader::DELTA)
+                    || (frames.empty() && frame.type != FrameHeader::KEY) || (!frames.empty() && frame.generation <= frames.back().generation)) {
+                    break;
+                }
+                if (frames.empty() && maxDecodedSize(frame.size) < (uint64_t)rowBytes * header.sizeY) {
+                    std::cerr << "\"" << filename << "\" isn't a recording.\n";
+                    return false;
+                }
+                frames.push_back({ frame.generation, offset, frame.size, frame.type });
+                offset += frame.size;
+                file.seekg((std::streamoff)offset);
+            }
+            if (frames.empty()) {
+                std::cerr << "Recording \"" << filename << "\" has no frames.\n";
+                return false;
+            }
+
+            ROW_BYTES = rowBytes;
+            cells.assign(ROW_BYTES * header.sizeY, 0);
+            delta.assign(cells.size(), 0);
+            return true;
+        }
+
+        /**
+        * Shows a generation of the recording on a board
+        * The board gets the recording's rule and edge mode, generations past the last frame are simulated
+        * Recordings don't hold ages, so every age starts at 0 again
+        * @param target is the generation to show, generations before the first frame show the first frame
+        * @param board is the board to write, it has to be the size of the recording
+        * @return false if the board is the wrong size or a frame is damaged
+        */
+        bool seek(uint64_t target, Board& board) {
+            if (frames.empty() || board.getBoardSizeX() != header.sizeX || board.getBoardSizeY() != header.sizeY) {
+                std::cerr << "The board is " << board.getBoardSizeX() << "x" << board.getBoardSizeY()
+                    << " but the recording is " << header.sizeX << "x" << header.sizeY << ".\n";
+                return false;
+            }
+            target = std::max(target, frames.front().generation);
+
+            // Last frame at or before the target, and the last key frame at or before that
+            size_t frame = std::upper_bound(frames.begin(), frames.end(), target,
+                [](uint64_t generation, const FrameEntry& entry) { return generation < entry.generation; }) - frames.begin() - 1;
+            size_t key = frame;
+            while (frames[key].type != FrameHeader::KEY) {
+                key--;
+            }
+
+            // Keep going from the last decoded frame when it's on the way
+            size_t from = key;
+            if (decoded >= (int64_t)key && decoded <= (int64_t)frame) {
+                from = (size_t)decoded + 1;
+            }
+            for (size_t f = from; f <= frame; f++)
+            {
+                if (!applyFrame(f)) {
+                    return false;
+                }
+            }
+
+            std::vector<char> row(header.sizeX);
+            for (int r = 0; r < (int)header.sizeY; r++)
+            {
+                unpackCells(&cells[ROW_BYTES * r], header.sizeX, row.data());
+                board.setRow(r, row.data());
+            }
+            board.clearAges();
+            // Setting the rule rebuilds its table, so only when it's a different one
+            Rule rule(header.birth, header.survive);
+            if (rule != board.getRule()) {
+                board.setRule(rule);
+            }
+            board.setEdgeMode(header.edgeMode == (uint8_t)Board::EdgeMode::Wrap ? Board::EdgeMode::Wrap : Board::EdgeMode::Dead);
+            board.generation = frames[frame].generation;
+
+            // Generations that weren't recorded are simulated from the frame before them
+            while (board.generation < target) {
+                board.nextGeneration();
+            }
+            return true;
+        }
+
+        uint64_t getFirstGeneration() {
+            return frames.empty() ? 0 : frames.front().generation;
+        }
+
+        uint64_t getLastGeneration() {
+            return frames.empty() ? 0 : frames.back().generation;
+        }
+
+        size_t frameCount() {
+            return frames.size();
+        }
+
+        size_t keyframeCount() {
+            return (size_t)std::count_if(frames.begin(), frames.end(), [](const FrameEntry& entry) { return entry.type == FrameHeader::KEY; });
+        }
+
+        // Generations between recorded frames
+        uint32_t getEvery() {
+            return header.every;
+        }
+
+        // Most generations between key frames
+        uint32_t getKeyframeInterval() {
+            return header.keyframeInterval;
+        }
+
+        uint32_t getBoardSizeX() {
+            return header.sizeX;
+        }
+
+        uint32_t getBoardSizeY() {
+            return header.sizeY;
+        }
+};
@@ -0,0 +1,216 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <cctype>
+
+// Life-like rules in B/S notation
+//
+// "B36/S23" means a dead cell with 3 or 6 live neighbors is born and a live cell
+// with 2 or 3 live neighbors survives, every other cell is dead next generation.
+// A cell's age goes up while it survives and resets when it's born or dies.
+//
+// Rule holds any rule as lookup tables. Common rules also have a FixedRule type where
+// the masks are compile time constants, the kernels get instantiated for each of those
+// and withRule picks the instantiation once per generation.
+
+struct Rule
+{
+    uint16_t birth = 1 << 3; // bit n is set if a dead cell with n neighbors is born
+    uint16_t survive = (1 << 2) | (1 << 3); // bit n is set if a live cell with n neighbors survives
+
+    // 0xFF at index n if the bit is set, laid out for byte shuffles so they're 16 long
+    uint8_t birthTable[16] = {};
+    uint8_t surviveTable[16] = {};
+
+    Rule() {
+        fillTables();
+    }
+
+    Rule(uint16_t newBirth, uint16_t newSurvive) {
+        birth = newBirth;
+        survive = newSurvive;
+        fillTables();
+    }
+
+    bool born(int numNeighbors) const {
+        return birthTable[numNeighbors] != 0;
+    }
+
+    bool survives(int numNeighbors) const {
+        return surviveTable[numNeighbors] != 0;
+    }
+
+    /**
+    * Reads a rule in B/S notation like "B3/S23", the letters can be lower case and either part can come first
+    * @param text is the rule string
+    * @param rule is set to the rule if the string is valid and left alone otherwise
+    * @return false if the string isn't a valid rule
+    */
+    static bool parse(const std::string& text, Rule& rule) {
+        uint16_t birth = 0;
+        uint16_t survive = 0;
+        bool hasBirth = false;
+        bool hasSurvive = false;
+        uint16_t* masks = nullptr;
+
+        for (char c : text)
+        {
+            char upper = (char)std::toupper((unsigned char)c);
+            if (upper == 'B' && !hasBirth) {
+                hasBirth = true;
+                masks = &birth;
+            }
+            else if (upper == 'S' && !hasSurvive) {
+                hasSurvive = true;
+                masks = &survive;
+            }
+            else if (c >= '0' && c <= '8' && masks) {
+                *masks |= 1 << (c - '0');
+            }
+            else if (c != '/' || !masks) {
+                return false;
+            }
+        }
+
+        if (!hasBirth || !hasSurvive) {
+            return false;
+        }
+        rule = Rule(birth, survive);
+        return true;
+    }
+
+    // The rule in B/S notation
+    std::string toString() const {
+        std::string text = "B";
+        for (int n = 0; n <= 8; n++)
+        {
+            if ((birth >> n) & 1) {
+                text += (char)('0' + n);
+            }
+        }
+        text += "/S";
+        for (int n = 0; n <= 8; n++)
+        {
+            if ((survive >> n) & 1) {
+                text += (char)('0' + n);
+            }
+        }
+        return text;
+    }
+
+    bool operator==(const Rule& other) const {
+        return birth == other.birth && survive == other.survive;
+    }
+
+    bool operator!=(const Rule& other) const {
+        return !(*this == other);
+    }
+
+    private:
+
+        void fillTables() {
+            for (int n = 0; n < 16; n++)
+            {
+                birthTable[n] = n <= 8 && ((birth >> n) & 1) ? 0xFF : 0;
+                surviveTable[n] = n <= 8 && ((survive >> n) & 1) ? 0xFF : 0;
+            }
+        }
+};
+
+// Generations rules like "B2/S/3", a live cell that doesn't survive goes through
+// states 2 to states - 1 before it's dead, dying cells don't count as neighbors
+struct GenerationsRule
+{
+    Rule rule;
+    int states = 3; // number of states including dead and alive
+
+    /**
+    * Reads a rule in B/S/C notation like "B2/S/3" or "B2/S/C3"
+    * @param text is the rule string
+    * @param generationsRule is set to the rule if the string is valid and left alone otherwise
+    * @return false if the string isn't a valid rule or has less than 2 or more than 256 states
+    */
+    static bool parse(const std::string& text, GenerationsRule& generationsRule) {
+        size_t slash = text.rfind('/');
+        if (slash == std::string::npos) {
+            return false;
+        }
+
+        std::string count = text.substr(slash + 1);
+        if (!count.empty() && std::toupper((unsigned char)count[0]) == 'C') {
+            count.erase(0, 1);
+        }
+        if (count.empty() || count.size() > 3 || count.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+
+        int states = std::stoi(count);
+        Rule rule;
+        if (states < 2 || states > 256 || !Rule::parse(text.substr(0, slash), rule)) {
+            return false;
+        }
+        generationsRule.rule = rule;
+        generationsRule.states = states;
+        return true;
+    }
+
+    // The rule in B/S/C notation
+    std::string toString() const {
+        return rule.toString() + "/" + std::to_string(states);
+    }
+};
+
+// A rule known at compile time, born and survives fold into the kernels
+template <uint16_t BIRTH, uint16_t SURVIVE>
+struct FixedRule
+{
+    enum : uint16_t { BIRTH_MASK = BIRTH, SURVIVE_MASK = SURVIVE };
+
+    constexpr bool born(int numNeighbors) const {
+        return ((BIRTH >> numNeighbors) & 1) != 0;
+    }
+
+    constexpr bool survives(int numNeighbors) const {
+        return ((SURVIVE >> numNeighbors) & 1) != 0;
+    }
+
+    static bool matches(const Rule& rule) {
+        return rule.birth == BIRTH && rule.survive == SURVIVE;
+    }
+};
+
+typedef FixedRule<1 << 3, (1 << 2) | (1 << 3)> LifeRule; // B3/S23
+typedef FixedRule<(1 << 3) | (1 << 6), (1 << 2) | (1 << 3)> HighLifeRule; // B36/S23
+typedef FixedRule<1 << 2, 0> SeedsRule; // B2/S
+typedef FixedRule<(1 << 3) | (1 << 6) | (1 << 7) | (1 << 8), (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 8)> DayAndNightRule; // B3678/S34678
+typedef FixedRule<1 << 3, (1 << 1) | (1 << 2) | (1 << 3) | (1 << 4) | (1 << 5)> MazeRule; // B3/S12345
+typedef FixedRule<1 << 3, 0x1FF> LifeWithoutDeathRule; // B3/S012345678
+
+/**
+* Calls f with the fastest version of a rule, a FixedRule if there is one and the Rule itself otherwise
+* This is meant to run once per generation, f then runs the whole generation with that rule type
+*/
+template <class F>
+void withRule(const Rule& rule, F&& f) {
+    if (LifeRule::matches(rule)) {
+        f(LifeRule());
+    }
+    else if (HighLifeRule::matches(rule)) {
+        f(HighLifeRule());
+    }
+    else if (SeedsRule::matches(rule)) {
+        f(SeedsRule());
+    }
+    else if (DayAndNightRule::matches(rule)) {
+        f(DayAndNightRule());
+    }
+    else if (MazeRule::matches(rule)) {
+        f(MazeRule());
+    }
+    else if (LifeWithoutDeathRule::matches(rule)) {
+        f(LifeWithoutDeathRule());
+    }
+    else {
+        f(rule);
+    }
+}
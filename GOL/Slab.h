@@ -0,0 +1,336 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "Board.h"
+#include "Transport.h"
+
+// A board split across processes, each worker owns a horizontal slab of rows
+//
+// A worker's Board holds its rows plus a halo row above and below. Before every generation
+// the workers send their top and bottom rows to their neighbors, which copy them into
+// their halos, then every worker steps its own Board. The halo rows are stepped along
+// with the rest but they're overwritten before anything reads them.
+//
+// The coordinator sends every worker its rows once, then tells the workers how many generations
+// to run and adds up what they report.
+// Checksums are a sum over rows so slabs can be added in any order, and they match
+// SlabWorker::checksum of the same cells in a single Board.
+
+// Sent by the coordinator before the first command, followed by the worker's rows
+struct SlabStart
+{
+    uint64_t generation;
+    uint16_t birth; // masks of the rule
+    uint16_t survive;
+    uint8_t wrap; // 1 for Board::EdgeMode::Wrap
+};
+
+// Sent by the coordinator, 0 generations tells the worker to stop
+struct SlabCommand
+{
+    uint64_t generations;
+};
+
+// Sent back after each command
+struct SlabReport
+{
+    uint64_t generation;
+    uint64_t population;
+    uint64_t checksum;
+};
+
+class SlabWorker
+{
+    private:
+
+        Transport& transport;
+        Board::EdgeMode edgeMode;
+        int64_t FIRST_ROW = 0; // first row of the whole board this worker owns
+        int ROWS = 0; // rows this worker owns
+        Board board; // ROWS + 2 rows, row 0 and row ROWS + 1 are the halos
+        uint64_t generation = 0;
+
+        // A slab that doesn't fit in a Board can't run, the Board is made smaller so it can be reported
+        bool fits() {
+            if (ROWS > MAX_SLAB_ROWS) {
+                std::cerr << "A slab of " << ROWS << " rows doesn't fit in a Board, it needs more workers.\n";
+                return false;
+            }
+            return true;
+        }
+
+        /**
+        * Sends the top and bottom rows to the neighbors and reads their rows into the halos
+        * Both rows go out before anything is read, so no worker waits on one that is also waiting
+        */
+        bool exchangeHalos() {
+            int rank = transport.getRank();
+            int workers = transport.getWorkerCount();
+            bool wrap = edgeMode == Board::EdgeMode::Wrap;
+            bool hasUp = wrap || rank > 0;
+            bool hasDown = wrap || rank + 1 < workers;
+            size_t width = board.getBoardSizeX();
+
+            if (hasUp && !transport.send(Transport::UP, board.getRow(1), width)) {
+                return false;
+            }
+            if (hasDown && !transport.send(Transport::DOWN, board.getRow(ROWS), width)) {
+                return false;
+            }
+
+            // Past a dead edge the halo stays dead, it has to be cleared again because it was stepped too
+            std::vector<char> halo(width, '.');
+            if (hasUp && !transport.receive(Transport::UP, halo.data(), width)) {
+                return false;
+            }
+            board.setRow(0, halo.data());
+
+            std::fill(halo.begin(), halo.end(), '.');
+            if (hasDown && !transport.receive(Transport::DOWN, halo.data(), width)) {
+                return false;
+            }
+            board.setRow(ROWS + 1, halo.data());
+            return true;
+        }
+
+    public:
+
+        enum { MAX_SLAB_ROWS = 65535 - 2 }; // a slab and its two halos have to fit in a Board
+
+        // Rows [total * rank / workers, total * (rank + 1) / workers) belong to a rank
+        static int64_t slabBegin(int64_t total, int rank, int workers) {
+            return total * rank / workers;
+        }
+
+        // True if every slab of a board split between this many workers fits in a Board
+        static bool slabsFit(int64_t total, int workers) {
+            return (total + workers - 1) / workers <= MAX_SLAB_ROWS;
+        }
+
+        /* CONSTRUCTOR */
+        /**
+        * @param newTransport connects this worker to its neighbors and the coordinator
+        * @param newBOARDSIZE_X and newBOARDSIZE_Y are the size of the whole board, each slab has to fit in a Board,
+        * see slabsFit, or receiveStart and serve fail
+        * @param newEdgeMode is how the whole board's edges behave
+        */
+        SlabWorker(Transport& newTransport, uint16_t newBOARDSIZE_X, int64_t newBOARDSIZE_Y, Board::EdgeMode newEdgeMode)
+            : transport(newTransport), edgeMode(newEdgeMode),
+            FIRST_ROW(slabBegin(newBOARDSIZE_Y, newTransport.getRank(), newTransport.getWorkerCount())),
+            ROWS((int)(slabBegin(newBOARDSIZE_Y, newTransport.getRank() + 1, newTransport.getWorkerCount()) - FIRST_ROW)),
+            board(newBOARDSIZE_X, (uint16_t)std::min(ROWS + 2, 65535)) {
+
+            // Wrapping columns is the Board's job, wrapping rows goes through the halos
+            board.setEdgeMode(edgeMode);
+            board.clearBoard();
+        }
+
+        // The slab's Board, for setting the rule or kernel, row 1 is FIRST_ROW of the whole board
+        Board& getBoard() {
+            return board;
+        }
+
+        int64_t getFirstRow() {
+            return FIRST_ROW;
+        }
+
+        int getRowCount() {
+            return ROWS;
+        }
+
+        // Takes rows of the whole board, cells owned by other workers are ignored
+        void setCell(int64_t row, int col, char state) {
+            if (row >= FIRST_ROW && row < FIRST_ROW + ROWS) {
+                board.setCell((int)(row - FIRST_ROW + 1), col, state);
+            }
+        }
+
+        char getCell(int64_t row, int col) {
+            return board.getCell((int)(row - FIRST_ROW + 1), col);
+        }
+
+        /**
+        * Reads the rows, rule, edge mode and generation the coordinator sends with SlabCoordinator::sendStart
+        * @return false if the link broke
+        */
+        bool receiveStart() {
+            if (!fits()) {
+                return false;
+            }
+            SlabStart start;
+            if (!transport.receive(Transport::COORDINATOR, &start, sizeof(start))) {
+                return false;
+            }
+            edgeMode = start.wrap ? Board::EdgeMode::Wrap : Board::EdgeMode::Dead;
+            board.setEdgeMode(edgeMode);
+            board.setRule(Rule(start.birth, start.survive));
+            generation = start.generation;
+
+            std::vector<char> row(board.getBoardSizeX());
+            for (int r = 1; r <= ROWS; r++)
+            {
+                if (!transport.receive(Transport::COORDINATOR, row.data(), row.size())) {
+                    return false;
+                }
+                board.setRow(r, row.data());
+            }
+            return true;
+        }
+
+        // Exchanges halos and steps once, false if a link broke
+        bool nextGeneration() {
+            if (!exchangeHalos()) {
+                return false;
+            }
+            board.nextGeneration();
+            generation++; // increment the generation
+            return true;
+        }
+
+        /**
+        * Hash of one row of the whole board, rows are added up into a board checksum
+        * @param cells is the row, "#" is alive and anything else is dead
+        * @param row is its row in the whole board
+        */
+        static uint64_t checksum(const char* cells, int width, int64_t row) {
+            uint64_t hash = 14695981039346656037ull ^ (uint64_t)row; // FNV-1a over the live cells
+            for (int col = 0; col < width; col++)
+            {
+                hash = (hash ^ (cells[col] == '#')) * 1099511628211ull;
+            }
+
+            // Mix it up so sums of similar rows don't cancel out
+            hash ^= hash >> 31;
+            hash *= 0x7FB5D329728EA185ull;
+            hash ^= hash >> 27;
+            return hash;
+        }
+
+        // Checksum of a whole Board, this matches what the coordinator adds up
+        static uint64_t checksum(Board& source) {
+            uint64_t sum = 0;
+            for (int row = 0; row < source.getBoardSizeY(); row++)
+            {
+                sum += checksum(source.getRow(row), source.getBoardSizeX(), row);
+            }
+            return sum;
+        }
+
+        // Population, checksum and generation of the rows this worker owns
+        SlabReport report() {
+            SlabReport result = { generation, 0, 0 };
+            for (int row = 1; row <= ROWS; row++)
+            {
+                const char* cells = board.getRow(row);
+                result.population += std::count(cells, cells + board.getBoardSizeX(), '#');
+                result.checksum += checksum(cells, board.getBoardSizeX(), FIRST_ROW + row - 1);
+            }
+            return result;
+        }
+
+        /**
+        * Runs commands from the coordinator until it says stop
+        * @return false if a link broke
+        */
+        bool serve() {
+            if (!fits()) {
+                return false;
+            }
+            SlabCommand command;
+            while (transport.receive(Transport::COORDINATOR, &command, sizeof(command)))
+            {
+                if (command.generations == 0) {
+                    return true;
+                }
+                for (uint64_t i = 0; i < command.generations; i++)
+                {
+                    if (!nextGeneration()) {
+                        return false;
+                    }
+                }
+                SlabReport result = report();
+                if (!transport.send(Transport::COORDINATOR, &result, sizeof(result))) {
+                    return false;
+                }
+            }
+            return false;
+        }
+};
+
+class SlabCoordinator
+{
+    private:
+
+        Transport& transport;
+
+    public:
+
+        SlabCoordinator(Transport& newTransport) : transport(newTransport) {
+        }
+
+        /**
+        * Sends every worker its rows of the starting board, along with the rule, edge mode and generation
+        * @param source is the whole board, the workers have to have been made for its size
+        * @return false if a worker didn't take it
+        */
+        bool sendStart(Board& source) {
+            Rule rule = source.getRule();
+            SlabStart start = { source.generation, rule.birth, rule.survive, (uint8_t)(source.getEdgeMode() == Board::EdgeMode::Wrap) };
+            int workers = transport.getWorkerCount();
+            for (int rank = 0; rank < workers; rank++)
+            {
+                if (!transport.send(rank, &start, sizeof(start))) {
+                    return false;
+                }
+                int64_t end = SlabWorker::slabBegin(source.getBoardSizeY(), rank + 1, workers);
+                for (int64_t row = SlabWorker::slabBegin(source.getBoardSizeY(), rank, workers); row < end; row++)
+                {
+                    if (!transport.send(rank, source.getRow((int)row), source.getBoardSizeX())) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        /**
+        * Runs every worker for some generations and adds up their reports
+        * @param generations is how many to run, at least 1
+        * @param total gets the whole board's population and checksum
+        * @return false if a worker didn't answer
+        */
+        bool run(uint64_t generations, SlabReport& total) {
+            SlabCommand command = { std::max<uint64_t>(1, generations) };
+            for (int rank = 0; rank < transport.getWorkerCount(); rank++)
+            {
+                if (!transport.send(rank, &command, sizeof(command))) {
+                    return false;
+                }
+            }
+
+            total = SlabReport();
+            for (int rank = 0; rank < transport.getWorkerCount(); rank++)
+            {
+                SlabReport result;
+                if (!transport.receive(rank, &result, sizeof(result))) {
+                    return false;
+                }
+                total.generation = result.generation;
+                total.population += result.population;
+                total.checksum += result.checksum;
+            }
+            return true;
+        }
+
+        // Tells every worker to stop
+        void stop() {
+            SlabCommand command = { 0 };
+            for (int rank = 0; rank < transport.getWorkerCount(); rank++)
+            {
+                transport.send(rank, &command, sizeof(command));
+            }
+        }
+};
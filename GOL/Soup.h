@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdlib>
+
+#include "FastNoise.h"
+
+// Random starting patterns made from FastNoise, cells where the noise is above 0 are alive
+
+// Noise set up the way the soups use it
+inline FastNoise soupNoise(int seed = 1337) {
+    FastNoise noise(seed);
+    noise.SetNoiseType(FastNoise::SimplexFractal);
+    return noise;
+}
+
+// Random offset into the noise, a different offset gives a different soup
+inline int randomNoiseOffset() {
+    return 1 + (rand() % 10000);
+}
+
+/**
+* Samples the noise for every cell of a sizeX x sizeY area
+* @param noise is the noise to sample, its seed picks the pattern
+* @param frequency scales the coordinates, higher gives smaller blobs
+* @param offset shifts the pattern
+* @param set is called with the row, the column and true if the cell is alive
+*/
+template <class F>
+void fillNoise(const FastNoise& noise, int sizeX, int sizeY, int frequency, int offset, F&& set) {
+    for (int x = 0; x < sizeX; x++)
+    {
+        for (int y = 0; y < sizeY; y++)
+        {
+            set(y, x, noise.GetNoise((FN_DECIMAL)(x * frequency + offset), (FN_DECIMAL)(y * frequency + offset)) > 0);
+        }
+    }
+}
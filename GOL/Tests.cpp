@@ -0,0 +1,344 @@
+// Tests.cpp : Checks engines against each other and against known results, exits with 1 if anything doesn't match.
+//
+// Slab workers are forked first, before any TBB threads exist, every other check runs after.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <random>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+#include "Board.h"
+#include "HashLife.h"
+#include "Slab.h"
+
+static int failures = 0;
+
+static void check(bool passed, const std::string& name) {
+    std::cout << (passed ? "pass  " : "FAIL  ") << name << '\n';
+    if (!passed) {
+        failures++;
+    }
+}
+
+// Random cells, the same ones every time for a seed
+static void fillRandom(Board& board, unsigned seed) {
+    std::mt19937 random(seed);
+    for (int row = 0; row < board.getBoardSizeY(); row++)
+    {
+        for (int col = 0; col < board.getBoardSizeX(); col++)
+        {
+            board.setCell(row, col, random() % 3 == 0 ? '#' : '.');
+        }
+    }
+}
+
+// Still blocks all over the board and a soup in the top left corner, tiles away from the soup settle
+// while the corner keeps changing
+static void fillSettling(Board& board, unsigned seed) {
+    std::mt19937 random(seed);
+    for (int row = 0; row < board.getBoardSizeY(); row++)
+    {
+        for (int col = 0; col < board.getBoardSizeX(); col++)
+        {
+            bool soup = row < 40 && col < 40;
+            bool block = row % 6 > 2 && row % 6 < 5 && col % 6 > 2 && col % 6 < 5 && row < board.getBoardSizeY() - 1 && col < board.getBoardSizeX() - 1;
+            board.setCell(row, col, soup ? (random() % 3 == 0 ? '#' : '.') : (block ? '#' : '.'));
+        }
+    }
+}
+
+#ifndef _WIN32
+// Workers for one slab check, launched before anything else runs
+struct SlabRun
+{
+    int workers;
+    Board::EdgeMode edgeMode;
+    SocketTransport transport;
+    bool launched = false;
+
+    SlabRun(int newWorkers, Board::EdgeMode newEdgeMode) : workers(newWorkers), edgeMode(newEdgeMode) {
+    }
+};
+
+static const int SLAB_X = 200;
+static const int SLAB_Y = 151;
+static const uint64_t SLAB_GENERATIONS = 150;
+
+static void launchSlabs(SlabRun& run) {
+    Board::EdgeMode edgeMode = run.edgeMode;
+    run.launched = SocketTransport::launch(run.workers, [edgeMode](Transport& link) -> int
+    {
+        SlabWorker worker(link, SLAB_X, SLAB_Y, edgeMode);
+        if (!worker.receiveStart()) {
+            return 1;
+        }
+        return worker.serve() ? 0 : 1;
+    }, run.transport);
+}
+
+// The split board has to end up where a single Board does
+static void testSlabs(SlabRun& run) {
+    std::string name = "slabs, " + std::to_string(run.workers) + " workers, " + (run.edgeMode == Board::EdgeMode::Wrap ? "wrapped" : "dead") + " edges";
+    if (!run.launched) {
+        check(false, name + ", launch");
+        return;
+    }
+
+    Board board(SLAB_X, SLAB_Y);
+    board.setEdgeMode(run.edgeMode);
+    board.setRule("B36/S23");
+    fillRandom(board, run.workers);
+
+    SlabCoordinator coordinator(run.transport);
+    SlabReport total = {};
+    bool ok = coordinator.sendStart(board) && coordinator.run(SLAB_GENERATIONS, total);
+    coordinator.stop();
+    ok = run.transport.wait() && ok;
+
+    for (uint64_t i = 0; i < SLAB_GENERATIONS; i++)
+    {
+        board.nextGeneration();
+    }
+    check(ok && total.generation == board.generation && total.population == board.population()
+        && total.checksum == SlabWorker::checksum(board), name);
+}
+#endif
+
+// Cells, ages and hashes of two boards are the same
+static bool sameBoard(Board& a, Board& b) {
+    if (a.generation != b.generation || a.getHash() != b.getHash()) {
+        return false;
+    }
+    for (int row = 0; row < a.getBoardSizeY(); row++)
+    {
+        if (std::memcmp(a.getRow(row), b.getRow(row), a.getBoardSizeX()) != 0) {
+            return false;
+        }
+        for (int col = 0; col < a.getBoardSizeX(); col++)
+        {
+            if (a.getCellAge(row, col) != b.getCellAge(row, col)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The rules written out as plainly as possible, one cell at a time over the whole board every generation
+struct PlainLife
+{
+    int width;
+    int height;
+    bool wrap;
+    Rule rule;
+    std::vector<char> cells;
+    std::vector<uint8_t> ages;
+
+    PlainLife(Board& start) : width(start.getBoardSizeX()), height(start.getBoardSizeY()),
+        wrap(start.getEdgeMode() == Board::EdgeMode::Wrap), rule(start.getRule()) {
+        for (int row = 0; row < height; row++)
+        {
+            cells.insert(cells.end(), start.getRow(row), start.getRow(row) + width);
+        }
+        ages.assign(cells.size(), 0);
+    }
+
+    bool alive(int row, int col) {
+        if (wrap) {
+            row = (row + height) % height;
+            col = (col + width) % width;
+        }
+        return row >= 0 && row < height && col >= 0 && col < width && cells[(size_t)row * width + col] == '#';
+    }
+
+    void nextGeneration() {
+        std::vector<char> next(cells.size());
+        for (int row = 0; row < height; row++)
+        {
+            for (int col = 0; col < width; col++)
+            {
+                int numNeighbors = 0;
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        numNeighbors += (dx != 0 || dy != 0) && alive(row + dy, col + dx);
+                    }
+                }
+                size_t i = (size_t)row * width + col;
+                bool survives = cells[i] == '#' && rule.survives(numNeighbors);
+                next[i] = survives || (cells[i] != '#' && rule.born(numNeighbors)) ? '#' : '.';
+                ages[i] = survives ? ages[i] + (ages[i] != 255) : 0;
+            }
+        }
+        cells.swap(next);
+    }
+
+    // Cells, ages and the hash of a board match, the hash against a board loaded with the same cells
+    bool matches(Board& board) {
+        Board loaded(width, height);
+        for (int row = 0; row < height; row++)
+        {
+            if (std::memcmp(board.getRow(row), &cells[(size_t)row * width], width) != 0) {
+                return false;
+            }
+            for (int col = 0; col < width; col++)
+            {
+                if (board.getCellAge(row, col) != ages[(size_t)row * width + col]) {
+                    return false;
+                }
+            }
+            loaded.setRow(row, &cells[(size_t)row * width]);
+        }
+        return loaded.getHash() == board.getHash();
+    }
+};
+
+/**
+* The scalar kernel has to match PlainLife, and every kernel, one generation at a time and in temporal
+* passes, has to match the scalar kernel. Sizes aren't multiples of a tile and most tiles settle,
+* so partial and skipped tiles are covered too.
+*/
+static void testKernels() {
+    const std::pair<const char*, Board::Kernel> kernels[] = {
+        { "scalar", Board::Kernel::Scalar },
+        { "sse41", Board::Kernel::SSE41 },
+        { "avx2", Board::Kernel::AVX2 },
+        { "table", Board::Kernel::Table },
+    };
+    const int sizes[][2] = { { 131, 97 }, { 300, 65 }, { 61, 200 } };
+    const char* rules[] = { "B3/S23", "B36/S23" };
+    const Board::EdgeMode edgeModes[] = { Board::EdgeMode::Dead, Board::EdgeMode::Wrap };
+    const int CHECKS = 6;
+    const int GENERATIONS = 12; // between checks, more than one temporal pass
+
+    // Runs 0 to 3 step each kernel one generation at a time, 4 to 7 in temporal passes
+    // and the last one is the scalar reference, checked against PlainLife
+    const int RUNS = 2 * 4 + 1;
+    std::string failed[RUNS]; // first failure of each run, empty while it passes
+    bool available[4];
+    unsigned seed = 1;
+
+    for (auto& size : sizes)
+    {
+        for (const char* rule : rules)
+        {
+            for (Board::EdgeMode edgeMode : edgeModes)
+            {
+                std::string where = std::to_string(size[0]) + "x" + std::to_string(size[1]) + " " + rule
+                    + (edgeMode == Board::EdgeMode::Wrap ? " wrapped" : " dead") + " at generation ";
+
+                std::vector<std::unique_ptr<Board>> boards;
+                for (int i = 0; i < RUNS; i++)
+                {
+                    boards.emplace_back(new Board(size[0], size[1]));
+                    Board& b = *boards.back();
+                    if (i < RUNS - 1) {
+                        available[i % 4] = b.setKernel(kernels[i % 4].second);
+                    }
+                    else {
+                        b.setKernel(Board::Kernel::Scalar);
+                    }
+                    b.setEdgeMode(edgeMode);
+                    b.setRule(rule);
+                    fillSettling(b, seed);
+                }
+                seed++;
+                Board& reference = *boards.back();
+                PlainLife plain(reference);
+
+                for (int c = 0; c < CHECKS; c++)
+                {
+                    for (int g = 0; g < GENERATIONS; g++)
+                    {
+                        plain.nextGeneration();
+                        reference.nextGeneration();
+                        for (int i = 0; i < 4; i++)
+                        {
+                            boards[i]->nextGeneration();
+                        }
+                    }
+                    for (int i = 4; i < 8; i++)
+                    {
+                        boards[i]->nextGenerations(GENERATIONS);
+                    }
+
+                    std::string when = where + std::to_string(reference.generation);
+                    if (failed[RUNS - 1].empty() && !plain.matches(reference)) {
+                        failed[RUNS - 1] = when;
+                    }
+                    for (int i = 0; i < RUNS - 1; i++)
+                    {
+                        if (available[i % 4] && failed[i].empty() && !sameBoard(reference, *boards[i])) {
+                            failed[i] = when;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    check(failed[RUNS - 1].empty(), "scalar kernel against a plain loop" + (failed[RUNS - 1].empty() ? "" : ", " + failed[RUNS - 1]));
+    for (int i = 0; i < RUNS - 1; i++)
+    {
+        std::string name = std::string("kernel ") + kernels[i % 4].first + (i < 4 ? ", one generation at a time" : ", temporal passes");
+        if (!available[i % 4]) {
+            std::cout << "skip  " << name << ", the CPU doesn't have it\n";
+            continue;
+        }
+        check(failed[i].empty(), name + (failed[i].empty() ? "" : ", " + failed[i]));
+    }
+}
+
+// A block on the origin in a single leaf, one step leaves the root smaller than a leaf and saving has to grow it back
+static void testMacrocellAfterStep() {
+    const char* path = "tests.mc";
+    std::ofstream(path) << "[M2]\n#R B3/S23\n$$$...**$...**$\n";
+
+    HashLife life;
+    bool ok = life.loadMacrocell(path);
+    life.step(0);
+    ok = ok && life.saveMacrocell(path);
+
+    HashLife loaded;
+    ok = ok && loaded.loadMacrocell(path) && loaded.generation == 1 && loaded.population() == 4;
+    for (int y = -8; y < 8; y++)
+    {
+        for (int x = -8; x < 8; x++)
+        {
+            ok = ok && loaded.getCell(x, y) == life.getCell(x, y);
+        }
+    }
+    std::remove(path);
+    check(ok, "macrocell save and load after step(0)");
+}
+
+/* MAIN */
+int main()
+{
+#ifndef _WIN32
+    SlabRun slabRuns[] = {
+        { 1, Board::EdgeMode::Dead },
+        { 3, Board::EdgeMode::Dead },
+        { 4, Board::EdgeMode::Wrap },
+    };
+    for (SlabRun& run : slabRuns)
+    {
+        launchSlabs(run);
+    }
+    for (SlabRun& run : slabRuns)
+    {
+        testSlabs(run);
+    }
+#endif
+
+    testKernels();
+    testMacrocellAfterStep();
+
+    std::cout << (failures ? std::to_string(failures) + " failed\n" : "All passed\n");
+    return failures ? 1 : 0;
+}
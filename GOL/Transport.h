@@ -0,0 +1,265 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// How the processes of a split board talk to each other
+//
+// Workers are ranked 0 to workers - 1 from the top of the board down and each one has a link
+// to the worker above it, the worker below it and the coordinator. The links form a ring,
+// the top worker's UP goes to the bottom worker. The coordinator talks to the workers by rank.
+// Messages on a link arrive in the order they were sent.
+
+class Transport
+{
+    public:
+
+        // Peers a worker can talk to, the coordinator uses ranks 0 and up instead
+        enum Peer { UP = -1, DOWN = -2, COORDINATOR = -3 };
+
+        virtual ~Transport() {
+        }
+
+        // Rank of this worker, -1 for the coordinator
+        virtual int getRank() = 0;
+
+        virtual int getWorkerCount() = 0;
+
+        /**
+        * Sends a message, this may return before the peer has received it
+        * @param peer is UP, DOWN or COORDINATOR for a worker and a rank for the coordinator
+        * @return false if the link is broken
+        */
+        virtual bool send(int peer, const void* data, size_t bytes) = 0;
+
+        // Waits for a message of exactly bytes bytes, false if the link is broken
+        virtual bool receive(int peer, void* data, size_t bytes) = 0;
+};
+
+#ifndef _WIN32
+
+// Transport over local socket pairs between processes forked from one parent
+class SocketTransport : public Transport
+{
+    private:
+
+        int rank = -1;
+        int workerCount = 0;
+        int upSocket = -1;
+        int downSocket = -1;
+        int coordinatorSocket = -1;
+        std::vector<int> workerSockets; // coordinator only, one per rank
+        std::vector<pid_t> workerPids; // coordinator only
+
+        int socketFor(int peer) {
+            if (peer == UP) {
+                return upSocket;
+            }
+            if (peer == DOWN) {
+                return downSocket;
+            }
+            if (peer == COORDINATOR) {
+                return coordinatorSocket;
+            }
+            return peer >= 0 && peer < (int)workerSockets.size() ? workerSockets[peer] : -1;
+        }
+
+        void closeAll() {
+            for (int fd : { upSocket, downSocket, coordinatorSocket })
+            {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+            for (int fd : workerSockets)
+            {
+                close(fd);
+            }
+            upSocket = downSocket = coordinatorSocket = -1;
+            workerSockets.clear();
+        }
+
+    public:
+
+        SocketTransport() {
+        }
+
+        SocketTransport(const SocketTransport&) = delete;
+        SocketTransport& operator=(const SocketTransport&) = delete;
+
+        ~SocketTransport() {
+            closeAll();
+        }
+
+        /**
+        * Forks the worker processes and connects everything, this process becomes the coordinator
+        * Call it before this process starts any TBB threads, the workers start their own
+        * @param workers is the number of processes to start
+        * @param work runs in each worker with its transport, its return value is the exit code
+        * @param coordinator is connected to the workers
+        * @return false if the sockets or processes couldn't be created, the error is printed
+        */
+        static bool launch(int workers, const std::function<int(Transport&)>& work, SocketTransport& coordinator) {
+            coordinator.closeAll();
+            coordinator.rank = -1;
+            coordinator.workerCount = workers;
+
+            // ring[i] links worker i (its DOWN) to worker i + 1 (its UP), control[i] links worker i to the coordinator
+            std::vector<int> ring(2 * workers, -1);
+            std::vector<int> control(2 * workers, -1);
+            bool ok = workers > 0;
+            for (int i = 0; ok && i < workers; i++)
+            {
+                ok = socketpair(AF_UNIX, SOCK_STREAM, 0, &ring[2 * i]) == 0 && socketpair(AF_UNIX, SOCK_STREAM, 0, &control[2 * i]) == 0;
+            }
+
+            // Halo rows are sent before they're received, so a whole row has to fit in the buffers
+            int bufferSize = 1 << 20;
+            for (int fd : ring)
+            {
+                if (fd >= 0) {
+                    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+                    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+                }
+            }
+
+            for (int i = 0; ok && i < workers; i++)
+            {
+                pid_t pid = fork();
+                if (pid < 0) {
+                    ok = false;
+                    break;
+                }
+                if (pid == 0) {
+                    SocketTransport worker;
+                    worker.rank = i;
+                    worker.workerCount = workers;
+                    worker.downSocket = ring[2 * i];
+                    worker.upSocket = ring[2 * ((i + workers - 1) % workers) + 1];
+                    worker.coordinatorSocket = control[2 * i + 1];
+                    for (int fd : ring)
+                    {
+                        if (fd >= 0 && fd != worker.downSocket && fd != worker.upSocket) {
+                            close(fd);
+                        }
+                    }
+                    for (int fd : control)
+                    {
+                        if (fd >= 0 && fd != worker.coordinatorSocket) {
+                            close(fd);
+                        }
+                    }
+                    for (int fd : coordinator.workerSockets)
+                    {
+                        close(fd);
+                    }
+                    coordinator.workerSockets.clear();
+
+                    int code = work(worker);
+                    worker.closeAll();
+                    _exit(code);
+                }
+                coordinator.workerPids.push_back(pid);
+                coordinator.workerSockets.push_back(control[2 * i]);
+                control[2 * i] = -1;
+            }
+
+            for (int fd : ring)
+            {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+            for (int fd : control)
+            {
+                if (fd >= 0) {
+                    close(fd);
+                }
+            }
+
+            if (!ok) {
+                std::cerr << "Couldn't start " << workers << " worker processes.\n";
+                for (pid_t pid : coordinator.workerPids)
+                {
+                    kill(pid, SIGTERM);
+                }
+                coordinator.wait();
+                coordinator.closeAll();
+            }
+            return ok;
+        }
+
+        /**
+        * Waits for every worker to exit, the coordinator calls this after telling them to stop
+        * @return false if any worker failed
+        */
+        bool wait() {
+            bool ok = true;
+            for (pid_t pid : workerPids)
+            {
+                int status = 0;
+                while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+                }
+                ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            }
+            workerPids.clear();
+            return ok;
+        }
+
+        int getRank() override {
+            return rank;
+        }
+
+        int getWorkerCount() override {
+            return workerCount;
+        }
+
+        bool send(int peer, const void* data, size_t bytes) override {
+            int fd = socketFor(peer);
+            const char* p = (const char*)data;
+            while (bytes > 0)
+            {
+                ssize_t sent = ::send(fd, p, bytes, MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent <= 0) {
+                    return false;
+                }
+                p += sent;
+                bytes -= (size_t)sent;
+            }
+            return true;
+        }
+
+        bool receive(int peer, void* data, size_t bytes) override {
+            int fd = socketFor(peer);
+            char* p = (char*)data;
+            while (bytes > 0)
+            {
+                ssize_t got = ::recv(fd, p, bytes, 0);
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (got <= 0) {
+                    return false;
+                }
+                p += got;
+                bytes -= (size_t)got;
+            }
+            return true;
+        }
+};
+
+#endif